@@ -2,11 +2,20 @@
 #include "app.h"
 #include "esp_log.h"
 #include "hid_func.h"
+#include "conn_params.h"
 #include "nvs_flash.h"
 #include "driver/i2c_master.h"
 #include "pins.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
 #include <algorithm>
 
+// Retry interval for motion the host did not accept
+static const TickType_t REPORT_RETRY_MIN = pdMS_TO_TICKS(8);
+static const TickType_t REPORT_RETRY_MAX = pdMS_TO_TICKS(1000);
+// Close to the connection interval, one coasting report per connection event
+static const uint32_t	MOMENTUM_TICK_MS = 10;
+
 extern "C" void ble_init();
 extern "C" void ble_deinit();
 
@@ -27,6 +36,9 @@ void app::init()
 	m_btn_mode.set_cb_on_hold_down([this]() { on_btn_mode_hold_down(); });
 	m_btn_cfg.set_cb_on_state_changed([this](button_state_t state) { on_btn_cfg_state_changed(state); });
 	m_btn_cfg.set_cb_on_click([this]() { on_btn_cfg_clicked(); });
+#ifdef CONFIG_TRACKBALL_FRAME_GRAB
+	m_btn_cfg.set_cb_on_hold_down([this]() { on_btn_cfg_hold_down(); });
+#endif
 	m_btn_scroll.set_cb_on_state_changed([this](button_state_t state) { on_btn_scroll_state_changed(state); });
 	m_btn_scroll.set_cb_on_click([this]() { on_btn_scroll_clicked(); });
 
@@ -50,11 +62,15 @@ void app::init()
 	buscfg.sclk_io_num		= PIN_NUM_CLK;
 	buscfg.quadwp_io_num	= -1;
 	buscfg.quadhd_io_num	= -1;
-	buscfg.max_transfer_sz	= 32;
+	buscfg.max_transfer_sz	= paw3395::FRAME_SIZE; // Raw frame is read in one transfer
 	ESP_ERROR_CHECK(spi_bus_initialize(SPI3_HOST, &buscfg, SPI_DMA_CH_AUTO));
 
+	// Below the sensor task, so sensor reads are never delayed by the radio
+	xTaskCreate(report_task, "motion_report", 4096, this, 4, &m_report_task);
+
 	m_sensor.init(SPI3_HOST, PIN_NUM_CS, PIN_NUM_MOTION, m_config.dpi,
-				  [this](int16_t dx, int16_t dy) { sensor_motion_callback(dx, dy); });
+				  [this](const paw3395::motion_data& data) { sensor_motion_callback(data); },
+				  [this]() { m_telemetry.idle(); });
 
 	// Initialize I2C bus for the OLED display
 	i2c_master_bus_config_t i2c_mst_config		= {};
@@ -76,10 +92,18 @@ void app::init()
 
 	apply_config();
 
+#ifdef CONFIG_TRACKBALL_MOTION_BENCHMARK
+	benchmark_motion(100000);
+#endif
+
 	m_connection_state_timer.start(1000, true, [this]() { on_update_connection_state(); });
 
 	m_battery.set_callback([this](int voltage, int level) { on_battery_state_changed(voltage, level); });
 	ESP_ERROR_CHECK(m_battery.init());
+
+#ifdef CONFIG_TRACKBALL_POWER_LOG
+	m_power_log_timer.start(CONFIG_TRACKBALL_POWER_LOG_INTERVAL * 60 * 1000, true, [this]() { on_power_log(); });
+#endif
 }
 
 void app::deinit()
@@ -105,98 +129,418 @@ void app::on_connection_changed()
 	int8_t rssi		 = 0;
 	bool   rssi_ok	 = hid_get_rssi(&rssi);
 	m_ui.set_connection_state(connected, rssi, rssi_ok);
+	if(connected)
+	{
+		// The mouse report of the previous connection is replaced with the current buttons and no motion
+		request_report();
+	}
+}
+
+void app::on_notify_ready()
+{
+	// The motion coalesced while no notification credit was left goes out from the report task
+	if(m_report_task)
+	{
+		xTaskNotifyGive(m_report_task);
+	}
 }
 
 void app::apply_config()
 {
-	m_sensor.set_dpi(m_config.dpi);
-	switch(m_config.sensor_mode)
+	if(m_config.software_dpi)
 	{
-	case SENSOR_MODE_LOW_POWER:
-		m_sensor.low_power_mode();
-		break;
-	case SENSOR_MODE_OFFICE:
-		m_sensor.office_mode();
-		break;
-	case SENSOR_MODE_GAMING:
-		m_sensor.gaming_mode();
-		break;
-	default:
-		m_sensor.high_performance_mode();
-		break;
+		m_sensor.set_dpi(m_config.sensor_dpi);
+	}
+	apply_dpi();
+	m_pointer_pipeline.stage<jitter_filter>().set(m_config.jitter_filter, m_config.jitter_min_cutoff,
+												  m_config.jitter_beta);
+	m_pointer_pipeline.stage<motion_accel>().set(m_config.pointer_accel);
+	m_pointer_pipeline.stage<precision_scaler>().set_ratio(m_config.precision_percent);
+	m_pointer_pipeline.stage<motion_transform>().set(m_config.sensor_rotation, m_config.flip_x, m_config.flip_y);
+	m_pointer_pipeline.stage<angle_snap>().set(m_config.angle_snap, m_config.angle_snap_degrees);
+	// Horizontal scroll runs against the pointer X axis
+	m_scroll_pipeline.stage<motion_transform>().set(m_config.sensor_rotation, !m_config.flip_x, m_config.flip_y);
+	apply_scroll_config();
+	m_telemetry.set_threshold(m_config.min_squal);
+	m_momentum.set(m_config.momentum_friction, m_config.momentum_start_speed, m_config.momentum_stop_speed);
+	m_sensor.set_power_config(m_config.sensor_power);
+	m_sensor.set_mode(m_config.sensor_mode);
+	m_sensor.set_poll_rate(m_config.poll_rate);
+	conn_params_set_idle(m_config.conn_idle_s * 1000, m_config.conn_sleep_s * 1000);
+}
+
+void app::apply_dpi()
+{
+	// The stages belong to the report task, it applies the new ratios before the next sample
+	m_motion_dpi_changed = true;
+	if(m_report_task)
+	{
+		xTaskNotifyGive(m_report_task);
+	} else
+	{
+		apply_motion_dpi();
+	}
+	if(!m_config.software_dpi)
+	{
+		uint32_t dpi_y		  = (uint32_t) m_config.dpi * m_config.dpi_y_percent / 100;
+		uint32_t scroll_dpi_y = (uint32_t) m_config.scroll_dpi * m_config.dpi_y_percent / 100;
+		bool	 scroll		  = m_app_state == APP_STATE_SCROLL_HOLD || m_app_state == APP_STATE_SCROLL_LOCK;
+		if(scroll)
+		{
+			m_sensor.set_dpi(m_config.scroll_dpi, scroll_dpi_y);
+		} else
+		{
+			m_sensor.set_dpi(m_config.dpi, dpi_y);
+		}
+	}
+}
+
+void app::apply_motion_dpi()
+{
+	m_motion_dpi_changed = false;
+	motion_scaler& pointer_scaler = m_pointer_pipeline.stage<motion_scaler>();
+	motion_scaler& scroll_scaler  = m_scroll_pipeline.stage<motion_scaler>();
+	// Counts are converted to the inches of the curve at the pointer resolution
+	m_pointer_pipeline.stage<motion_accel>().set_resolution(m_config.dpi);
+	if(m_config.software_dpi)
+	{
+		// The sensor stays at sensor_dpi, the motion is scaled on the next sample
+		uint32_t dpi_y		  = (uint32_t) m_config.dpi * m_config.dpi_y_percent / 100;
+		uint32_t scroll_dpi_y = (uint32_t) m_config.scroll_dpi * m_config.dpi_y_percent / 100;
+		pointer_scaler.set_ratio(m_config.dpi, dpi_y, m_config.sensor_dpi);
+		scroll_scaler.set_ratio(m_config.scroll_dpi, scroll_dpi_y, m_config.sensor_dpi);
+	} else
+	{
+		pointer_scaler.set_ratio(1, 1);
+		scroll_scaler.set_ratio(1, 1);
 	}
 }
 
 extern uint8_t resolution_multiplier;
 
-void app::sensor_motion_callback(int16_t dx, int16_t dy)
+void app::apply_scroll_config()
+{
+	bool wheel = m_config.scroll_mode & SCROLL_MODE_ENABLE_VSCROLL;
+	bool pan   = m_config.scroll_mode & SCROLL_MODE_ENABLE_HSCROLL;
+	m_scroll_converter.set(m_config.scroll_sensitivity, wheel, pan, m_config.enable_high_res_scroll,
+						   &resolution_multiplier);
+	// The dominant axis only matters when both axes scroll
+	m_scroll_pipeline.stage<scroll_axis_lock>().set(m_config.scroll_axis_lock && wheel && pan,
+													m_config.scroll_axis_ratio);
+}
+
+void app::sensor_motion_callback(const paw3395::motion_data& data)
 {
-	bool		   b_send_report = false;
-	int8_t		   wheel		 = 0;
-	int8_t		   ac_pan		 = 0;
-	static int32_t wheel_buffer	 = 0;
-	static int32_t ac_pan_buffer = 0;
-	if(m_app_state == APP_STATE_SCROLL_HOLD || m_app_state == APP_STATE_SCROLL_LOCK)
-	{
-		if(m_config.enable_high_res_scroll)
+	if(!m_telemetry.update(data, esp_timer_get_time()))
+	{
+		// The ball is lifted or the surface is too dirty to track
+		return;
+	}
+
+	// Never waits for the radio, the report task picks the motion up
+	m_motion_queue.push(data.dx, data.dy);
+	xTaskNotifyGive(m_report_task);
+}
+
+void app::report_task(void* param)
+{
+	auto	   pThis = static_cast<app*>(param);
+	int32_t	   dx, dy;
+	uint32_t   samples;
+	TickType_t retry = REPORT_RETRY_MIN;
+	while(true)
+	{
+		// Motion the host did not accept is sent again, with a growing interval while it keeps failing.
+		// The rest of a flick beyond the 16 bit report fields follows at the sample rate.
+		uint16_t   rate	   = std::max<uint16_t>(pThis->m_config.poll_rate, 1);
+		TickType_t sample  = std::max<TickType_t>(pdMS_TO_TICKS(1000 / rate), 1);
+		bool	   pending = hid_mouse_has_pending();
+		TickType_t wait	   = !pending ? portMAX_DELAY : pThis->m_report_refused ? retry : sample;
+		bool	   held	   = !pThis->m_scrolling && pThis->m_pointer_pipeline.pending();
+		if(held)
 		{
-			if(m_config.scroll_mode & SCROLL_MODE_ENABLE_VSCROLL)
-			{
-				wheel = std::clamp(dy * 2, -32768, 32767);
-			}
-			if(m_config.scroll_mode & SCROLL_MODE_ENABLE_HSCROLL)
-			{
-				ac_pan = std::clamp(dx * 2, -32768, 32767);
-			}
-			b_send_report = wheel != 0 || ac_pan != 0;
-		} else
+			wait = std::min(wait, sample);
+		}
+		BaseType_t notified = ulTaskNotifyTake(pdTRUE, wait);
+		if(pThis->m_motion_dpi_changed)
 		{
-			if(m_config.scroll_mode & SCROLL_MODE_ENABLE_VSCROLL)
-			{
-				wheel_buffer += dy;
-			}
-			if(m_config.scroll_mode & SCROLL_MODE_ENABLE_HSCROLL)
+			pThis->apply_motion_dpi();
+		}
+		if(!notified)
+		{
+			if(held)
 			{
-				ac_pan_buffer += dx;
+				pThis->process_held_motion(sample * portTICK_PERIOD_MS * 1000);
+				continue;
 			}
-			if(wheel_buffer > m_config.scroll_sensitivity)
-			{
-				wheel		  = (int16_t)resolution_multiplier;
-				b_send_report = true;
-				wheel_buffer  = 0;
-			} else if(wheel_buffer < -m_config.scroll_sensitivity)
+			pThis->send_report();
+			retry = pThis->m_report_refused ? std::min<TickType_t>(retry * 2, REPORT_RETRY_MAX) : REPORT_RETRY_MIN;
+			continue;
+		}
+		// Button changes go out before the motion which follows them
+		bool requested = pThis->m_report_requested.exchange(false);
+		if(requested)
+		{
+			pThis->send_report();
+		}
+		// Everything queued while the previous report was sent goes out as one report
+		if(pThis->m_motion_queue.pop_all(dx, dy, samples))
+		{
+			pThis->process_motion(dx, dy, samples);
+		} else if(!pThis->process_momentum() && !requested)
+		{
+			if(!hid_mouse_has_pending())
 			{
-				wheel		  = -((int16_t) resolution_multiplier);
-				b_send_report = true;
-				wheel_buffer  = 0;
+				// A momentum tick with nothing to send keeps the retry backoff
+				continue;
 			}
-			if(ac_pan_buffer > m_config.scroll_sensitivity)
-			{
-				ac_pan		  = (int16_t)resolution_multiplier;
-				b_send_report = true;
-				ac_pan_buffer = 0;
-			} else if(ac_pan_buffer < -m_config.scroll_sensitivity)
+			// A notification credit came back, send the coalesced motion
+			pThis->send_report();
+		}
+		retry = REPORT_RETRY_MIN;
+	}
+}
+
+void app::process_motion(int32_t dx, int32_t dy, uint32_t samples)
+{
+	bool scroll = m_app_state == APP_STATE_SCROLL_HOLD || m_app_state == APP_STATE_SCROLL_LOCK;
+
+	conn_params_activity();
+
+	// The sensor collected the motion over the merged samples. The time since the previous call
+	// is not used: it spans the pause before the first sample and the radio stalls of merged ones.
+	int64_t	 now	   = esp_timer_get_time();
+	uint32_t sample_us = 1000000 / std::max<uint16_t>(m_config.poll_rate, 1);
+	motion_sample s	   = {};
+	s.x				   = dx;
+	s.y				   = dy;
+	s.dt_us			   = std::max<uint32_t>(samples, 1) * sample_us;
+	s.time			   = now;
+
+	// A remainder left from the other mode must not leak in
+	if(scroll != m_scrolling)
+	{
+		if(!m_scrolling)
+		{
+			// The motion held back by the pointer stages belongs to the drag which ends here
+			motion_sample held = {};
+			held.time		   = now;
+			m_pointer_pipeline.flush(held);
+			if(held.x != 0 || held.y != 0)
 			{
-				ac_pan		  = -((int16_t)resolution_multiplier);
-				b_send_report = true;
-				ac_pan_buffer = 0;
+				send_report(held.x, held.y, 0, 0);
 			}
 		}
-		dx = 0;
-		dy = 0;
-	} else
+		m_pointer_pipeline.reset();
+		m_scroll_pipeline.reset();
+		m_scroll_converter.reset();
+		m_momentum.reset();
+		m_scrolling = scroll;
+	}
+
+	if(scroll)
 	{
-		wheel_buffer  = 0;
-		ac_pan_buffer = 0;
-		b_send_report = dx != 0 || dy != 0;
+		m_scroll_pipeline.process(s);
+		if(m_app_state == APP_STATE_SCROLL_LOCK)
+		{
+			m_momentum.add(s.x, s.y, now);
+		}
+		send_scroll(s.x, s.y);
+		return;
 	}
-	if(b_send_report)
+	m_pointer_pipeline.process(s);
+	if(s.x != 0 || s.y != 0)
 	{
-		send_report(-dx, dy, wheel, ac_pan);
-		vTaskDelay(pdMS_TO_TICKS(2));
-	} else
+		// The HID layer splits motion beyond the 16 bit report fields over several reports
+		send_report(s.x, s.y, 0, 0);
+	}
+}
+
+void app::process_held_motion(uint32_t dt_us)
+{
+	motion_sample s = {};
+	s.dt_us			= dt_us;
+	s.time			= esp_timer_get_time();
+	m_pointer_pipeline.process(s);
+	if(s.x != 0 || s.y != 0)
 	{
-		vTaskDelay(pdMS_TO_TICKS(1));
+		send_report(s.x, s.y, 0, 0);
+	}
+}
+
+bool app::process_momentum()
+{
+	if(m_app_state != APP_STATE_SCROLL_LOCK || !m_config.momentum_scroll)
+	{
+		m_momentum.reset();
+		return false;
+	}
+	int32_t x, y;
+	if(!m_momentum.step(x, y, esp_timer_get_time()))
+	{
+		return false;
+	}
+	send_scroll(x, y);
+	return true;
+}
+
+void app::send_scroll(int32_t x, int32_t y)
+{
+	motion_sample s = {};
+	s.x				= x;
+	s.y				= y;
+	m_scroll_converter.process(s);
+	if(s.wheel != 0 || s.ac_pan != 0)
+	{
+		send_report(0, 0, s.wheel, s.ac_pan);
+	}
+}
+
+void app::benchmark_motion(uint32_t samples)
+{
+	// A right angle, as used by the enclosures, and an arbitrary one
+	const int rotations[] = {90, 30};
+	for(int rotation : rotations)
+	{
+		motion_transform transform;
+		transform.set(rotation, true, false);
+		int32_t sum	  = 0;
+		int64_t start = esp_timer_get_time();
+		for(uint32_t i = 0; i < samples; i++)
+		{
+			int32_t x = (int32_t) (i & 0x3F) - 32;
+			int32_t y = (int32_t) ((i >> 6) & 0x3F) - 32;
+			transform.process(x, y);
+			sum += x + y;
+		}
+		int64_t us = esp_timer_get_time() - start;
+		ESP_LOGI("app", "Motion transform, rotation %d: %.1f ns per sample (checksum %ld)", rotation,
+				 (float) us * 1000.0f / samples, sum);
+	}
+
+	// Pointer acceleration, one table lookup and interpolation per sample
+	const accel_curve_t curves[] = {ACCEL_CURVE_LINEAR, ACCEL_CURVE_NATURAL, ACCEL_CURVE_SIGMOID};
+	for(accel_curve_t curve : curves)
+	{
+		accel_config cfg;
+		cfg.curve = curve;
+		motion_accel accel;
+		accel.set(cfg);
+		accel.set_resolution(1200);
+		int32_t	 sum   = 0;
+		uint32_t start = esp_cpu_get_cycle_count();
+		for(uint32_t i = 0; i < samples; i++)
+		{
+			int32_t x = (int32_t) (i & 0x3F) - 32;
+			int32_t y = (int32_t) ((i >> 6) & 0x3F) - 32;
+			accel.process(x, y, 1000);
+			sum += x + y;
+		}
+		uint32_t cycles = esp_cpu_get_cycle_count() - start;
+		ESP_LOGI("app", "Pointer acceleration, curve %d: %lu cycles per sample (checksum %ld)", curve,
+				 cycles / samples, sum);
+	}
+
+	// Jitter filter: cost per sample and the lag behind a constant motion, sampled every 1 ms
+	const int32_t speeds[] = {1, 10, 100};
+	for(int32_t speed : speeds)
+	{
+		jitter_filter filter;
+		filter.set(true, 100, 70);
+		int64_t	 in		= 0;
+		int64_t	 out	= 0;
+		uint32_t start	= esp_cpu_get_cycle_count();
+		for(uint32_t i = 0; i < samples; i++)
+		{
+			// +-1 count of sensor noise
+			int32_t x = speed + ((i & 1) ? 1 : -1);
+			int32_t y = 0;
+			in += x;
+			filter.process(x, y, 1000);
+			out += x;
+		}
+		uint32_t cycles = esp_cpu_get_cycle_count() - start;
+		ESP_LOGI("app", "Jitter filter, %ld counts/ms: %lu cycles per sample, lag %lld counts = %.2f ms", speed,
+				 cycles / samples, in - out, (float) (in - out) / speed);
+	}
+
+	// Composed pointer pipeline against the same stages called one by one
+	{
+		accel_config cfg;
+		cfg.curve = ACCEL_CURVE_NATURAL;
+		pointer_pipeline pipeline;
+		pipeline.stage<motion_scaler>().set_ratio(1200, 1600);
+		pipeline.stage<jitter_filter>().set(true, 100, 70);
+		pipeline.stage<motion_accel>().set(cfg);
+		pipeline.stage<motion_transform>().set(90, true, false);
+		motion_scaler	 scaler;
+		jitter_filter	 filter;
+		motion_accel	 accel;
+		motion_transform transform;
+		scaler.set_ratio(1200, 1600);
+		filter.set(true, 100, 70);
+		accel.set(cfg);
+		transform.set(90, true, false);
+
+		int32_t	 sum_pipeline = 0;
+		uint32_t start		  = esp_cpu_get_cycle_count();
+		for(uint32_t i = 0; i < samples; i++)
+		{
+			motion_sample s = {};
+			s.x				= (int32_t) (i & 0x3F) - 32;
+			s.y				= (int32_t) ((i >> 6) & 0x3F) - 32;
+			s.dt_us			= 1000;
+			pipeline.process(s);
+			sum_pipeline += s.x + s.y;
+		}
+		uint32_t cycles_pipeline = esp_cpu_get_cycle_count() - start;
+
+		int32_t sum_direct = 0;
+		start			   = esp_cpu_get_cycle_count();
+		for(uint32_t i = 0; i < samples; i++)
+		{
+			int32_t x = (int32_t) (i & 0x3F) - 32;
+			int32_t y = (int32_t) ((i >> 6) & 0x3F) - 32;
+			scaler.process(x, y);
+			filter.process(x, y, 1000);
+			accel.process(x, y, 1000);
+			transform.process(x, y);
+			sum_direct += x + y;
+		}
+		uint32_t cycles_direct = esp_cpu_get_cycle_count() - start;
+		ESP_LOGI("app", "Pointer pipeline: %lu cycles per sample composed, %lu called directly (checksum %ld/%ld)",
+				 cycles_pipeline / samples, cycles_direct / samples, sum_pipeline, sum_direct);
+	}
+
+	// Scroll trace: slow roll, reversal, fast flick. The reported distance must follow the ball travel.
+	struct trace_step
+	{
+		int32_t  counts; // Ball travel per sample
+		uint32_t repeat; // Samples
+	};
+	const trace_step trace[] = {{1, 1000}, {-3, 250}, {7, 300}, {2500, 40}, {-1, 77}};
+	const bool		 modes[] = {true, false};
+	for(bool high_res : modes)
+	{
+		const uint32_t sensitivity = 100;
+		const uint32_t multiplier  = 120;
+		scroll_axis	   axis;
+		int64_t		   travel	= 0;
+		int64_t		   reported = 0;
+		int64_t		   start	= esp_timer_get_time();
+		for(const trace_step& step : trace)
+		{
+			for(uint32_t i = 0; i < step.repeat; i++)
+			{
+				travel += step.counts;
+				reported += axis.process(step.counts, sensitivity, multiplier, high_res);
+			}
+		}
+		int64_t us = esp_timer_get_time() - start;
+		// Less than one unit (one detent in low resolution mode) may stay in the remainder
+		float error = (float) reported / multiplier - (float) travel / sensitivity;
+		ESP_LOGI("app", "Scroll trace, %s resolution: travel %.2f detents, reported %.2f, error %.3f, %lld us",
+				 high_res ? "high" : "low", (float) travel / sensitivity, (float) reported / multiplier, error, us);
 	}
 }
 
@@ -215,10 +559,38 @@ void app::on_btn_cfg_clicked()
 	}
 	dpi_idx = (dpi_idx + 1) % PREDEFINED_DPI_COUNT;
 	m_config.dpi = m_config.predefined_dpi[dpi_idx];
-	m_sensor.set_dpi(m_config.dpi);
+	apply_dpi();
 	m_ui.set_dpi(m_config.dpi);
 }
 
+void app::on_btn_cfg_hold_down()
+{
+	// Stream one raw sensor frame to the console, tools/frame_grab.py converts it to PGM
+	static uint32_t frame_num = 0;
+	uint8_t*		frame	  = static_cast<uint8_t*>(malloc(paw3395::FRAME_SIZE));
+	if(!frame)
+	{
+		return;
+	}
+	if(m_sensor.frame_grab(frame) == ESP_OK)
+	{
+		const size_t chunk = 64;
+		printf("FRAME_BEGIN %lu %u %u\n", frame_num, paw3395::FRAME_WIDTH, paw3395::FRAME_HEIGHT);
+		for(size_t offset = 0; offset < paw3395::FRAME_SIZE; offset += chunk)
+		{
+			printf("FRAME_DATA %u ", offset);
+			for(size_t i = offset; i < offset + chunk && i < paw3395::FRAME_SIZE; i++)
+			{
+				printf("%02X", frame[i]);
+			}
+			printf("\n");
+		}
+		printf("FRAME_END %lu\n", frame_num);
+		frame_num++;
+	}
+	free(frame);
+}
+
 void app::on_btn_mode_clicked()
 {
 	const int mode_count = 3;
@@ -239,7 +611,8 @@ void app::on_btn_mode_clicked()
 	}
 	mode = (mode + 1) % mode_count;
 	m_config.scroll_mode = modes[mode];
-	uint8_t scroll_mode	 = m_config.scroll_mode;
+	apply_scroll_config();
+	uint8_t scroll_mode = m_config.scroll_mode;
 	if(m_config.enable_high_res_scroll)
 	{
 		scroll_mode |= SCROLL_MODE_HIGH_RES;
@@ -250,6 +623,7 @@ void app::on_btn_mode_clicked()
 void app::on_btn_mode_hold_down()
 {
 	m_config.enable_high_res_scroll = !m_config.enable_high_res_scroll;
+	apply_scroll_config();
 
 	uint8_t scroll_mode = m_config.scroll_mode;
 	if(m_config.enable_high_res_scroll)
@@ -261,21 +635,18 @@ void app::on_btn_mode_hold_down()
 
 void app::on_btn_scroll_state_changed(button_state_t state)
 {
+	conn_params_activity();
 	if(state == button_state_t::pressed)
 	{
 		if(m_app_state == APP_STATE_DEFAULT)
 		{
-			m_app_state = APP_STATE_SCROLL_HOLD;
-			m_ui.set_ui_state(UI_STATE_SCROLL_LOCK);
-			m_sensor.set_dpi(m_config.scroll_dpi);
+			set_app_state(APP_STATE_SCROLL_HOLD);
 		}
 	} else
 	{
 		if(m_app_state == APP_STATE_SCROLL_HOLD)
 		{
-			m_app_state = APP_STATE_DEFAULT;
-			m_ui.set_ui_state(UI_STATE_DEFAULT);
-			m_sensor.set_dpi(m_config.dpi);
+			set_app_state(APP_STATE_DEFAULT);
 		}
 	}
 }
@@ -284,11 +655,10 @@ void app::on_btn_scroll_clicked()
 {
 	if(m_app_state == APP_STATE_DEFAULT || m_app_state == APP_STATE_SCROLL_HOLD)
 	{
-		m_locked_buttons = m_buttons;
+		m_locked_buttons = m_buttons.load();
 		if(m_locked_buttons == 0)
 		{
 			set_app_state(APP_STATE_SCROLL_LOCK);
-			m_sensor.set_dpi(m_config.scroll_dpi);
 		} else
 		{
 			set_app_state(APP_STATE_LOCK_BUTTONS);
@@ -297,8 +667,7 @@ void app::on_btn_scroll_clicked()
 	{
 		m_buttons = 0;
 		set_app_state(APP_STATE_DEFAULT);
-		m_sensor.set_dpi(m_config.dpi);
-		send_report();
+		request_report();
 	}
 }
 
@@ -308,6 +677,54 @@ void app::on_update_connection_state()
 	int8_t rssi		 = 0;
 	bool   rssi_ok	 = hid_get_rssi(&rssi);
 	m_ui.set_connection_state(connected, rssi, rssi_ok);
+	update_telemetry();
+	// Steps the connection parameters down after the idle periods
+	conn_params_tick();
+}
+
+void app::update_telemetry()
+{
+	surface_telemetry::stats stats;
+	uint32_t				 seq = 0;
+	if(!m_telemetry.read(stats, &seq) || seq == m_telemetry_seq)
+	{
+		return;
+	}
+	m_telemetry_seq = seq;
+	m_ui.set_surface_quality(stats.squal_avg, stats.lifted);
+
+	motion_queue::stats queue = m_motion_queue.get_stats();
+	ESP_LOGD("app", "Motion queue: %lu pushed, %lu coalesced, %lu overflows, depth %lu (max %lu)", queue.pushed,
+			 queue.coalesced, queue.overflows, queue.depth, queue.depth_max);
+	hid_flow_stats flow;
+	hid_get_flow_stats(&flow);
+	ESP_LOGD("app", "Notifications: %lu in flight (max %lu), %lu reports coalesced, %lu errors", flow.in_flight,
+			 flow.in_flight_max, flow.coalesced, flow.errors);
+	ESP_LOGD("app", "Transmit mbufs: %lu exhausted, %lu of %d free at least", flow.mbuf_exhausted, flow.mbuf_min_free,
+			 HID_MBUF_COUNT);
+	conn_params_stats conn;
+	conn_params_get_stats(&conn);
+	ESP_LOGD("app", "Connection: level %d, itvl %d, latency %d, %lu updates (%lu failed), renegotiation %lu us (max %lu us)",
+			 conn.level, conn.itvl, conn.latency, conn.updates, conn.failures, conn.renegotiate_us,
+			 conn.renegotiate_max_us);
+	ESP_LOGD("app", "First report after idle %lu us (max %lu us)", conn.wake_latency_us, conn.wake_latency_max_us);
+
+	if(hid_get_connected())
+	{
+		uint8_t buf[HIDD_LE_TELEMETRY_SIZE] = {
+			stats.squal_avg,
+			stats.squal_min,
+			stats.squal_max,
+			stats.raw_data_sum_avg,
+			(uint8_t) (stats.shutter_avg & 0xFF),
+			(uint8_t) (stats.shutter_avg >> 8),
+			(uint8_t) (stats.samples & 0xFF),
+			(uint8_t) (stats.samples >> 8),
+			(uint8_t) (stats.suppressed & 0xFF),
+			(uint8_t) (stats.suppressed >> 8),
+		};
+		hid_telemetry_set(buf);
+	}
 }
 
 void app::on_battery_state_changed(int voltage, int level)
@@ -319,8 +736,54 @@ void app::on_battery_state_changed(int voltage, int level)
 	}
 }
 
+void app::on_power_log()
+{
+#ifdef CONFIG_TRACKBALL_POWER_LOG
+	int voltage = 0;
+	int level	= 0;
+	m_battery.get_state(voltage, level);
+	int64_t now = esp_timer_get_time();
+
+	// Battery voltage trend since the previous log, compare it between the sensor rest settings
+	if(m_power_log_time != 0 && m_power_log_voltage != 0)
+	{
+		int64_t elapsed_s = (now - m_power_log_time) / 1000000;
+		if(elapsed_s > 0)
+		{
+			ESP_LOGI("app", "Battery: %d mV, %d%%, trend %lld mV/h", voltage, level,
+					 (int64_t) (voltage - m_power_log_voltage) * 3600 / elapsed_s);
+		}
+	}
+	m_power_log_voltage = voltage;
+	m_power_log_time	= now;
+
+	paw3395::power_stats stats = m_sensor.get_power_stats();
+	uint64_t			 total = 0;
+	for(int i = 0; i < paw3395::POWER_STATE_COUNT; i++)
+	{
+		total += stats.time_ms[i];
+	}
+	for(int i = 0; i < paw3395::POWER_STATE_COUNT; i++)
+	{
+		auto state = static_cast<paw3395::power_state_t>(i);
+		ESP_LOGI("app", "Sensor %s: %llu%% of time, %lu wake ups, first report %lu us (max %lu us)",
+				 paw3395::power_state_name(state), total ? stats.time_ms[i] * 100ULL / total : 0, stats.wakes[i],
+				 stats.wake_latency_us[i], stats.wake_latency_max_us[i]);
+	}
+#endif
+}
+
 void app::apply_button_function(button_state_t state, button_function_t func)
 {
+	conn_params_activity();
+	if(func == BTN_FNC_PRECISION)
+	{
+		// Not a HID button, the next motion sample is scaled
+		bool active = state == button_state_t::pressed;
+		m_pointer_pipeline.stage<precision_scaler>().set_active(active);
+		m_ui.set_precision(active);
+		return;
+	}
 	if(state == button_state_t::pressed)
 	{
 		switch(func)
@@ -356,7 +819,7 @@ void app::apply_button_function(button_state_t state, button_function_t func)
 	}
 	if(m_app_state != APP_STATE_LOCK_BUTTONS)
 	{
-		send_report();
+		request_report();
 	}
 }
 
@@ -365,6 +828,14 @@ void app::set_app_state(app_state_t state)
 	if(m_app_state == state)
 		return;
 	m_app_state = state;
+	apply_dpi();
+	if(m_app_state == APP_STATE_SCROLL_LOCK && m_config.momentum_scroll)
+	{
+		m_momentum_timer.start(MOMENTUM_TICK_MS, true, [this]() { xTaskNotifyGive(m_report_task); });
+	} else
+	{
+		m_momentum_timer.stop();
+	}
 	switch(m_app_state)
 	{
 	case APP_STATE_DEFAULT:
@@ -389,7 +860,16 @@ void app::set_app_state(app_state_t state)
 	}
 }
 
-void app::send_report(int16_t dx, int16_t dy, int16_t wheel, int16_t ac_pan)
+void app::send_report(int32_t dx, int32_t dy, int32_t wheel, int32_t ac_pan)
 {
-	hid_mouse_send_report(get_report_buttons(), dx, dy, wheel, ac_pan);
+	m_report_refused = hid_mouse_send_report(get_report_buttons(), dx, dy, wheel, ac_pan) != 0;
+}
+
+void app::request_report()
+{
+	m_report_requested = true;
+	if(m_report_task)
+	{
+		xTaskNotifyGive(m_report_task);
+	}
 }
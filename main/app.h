@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include "battery.h"
 #include "paw3395.h"
 #include "button.h"
@@ -8,6 +10,19 @@
 #include "timer.h"
 #include "nvs_flash.h"
 #include "types.h"
+#include "angle_snap.h"
+#include "jitter_filter.h"
+#include "motion_accel.h"
+#include "motion_pipeline.h"
+#include "motion_queue.h"
+#include "motion_scaler.h"
+#include "motion_transform.h"
+#include "precision_scaler.h"
+#include "scroll_axis_lock.h"
+#include "scroll_converter.h"
+#include "scroll_momentum.h"
+#include "surface_telemetry.h"
+#include "sdkconfig.h"
 
 enum app_state_t
 {
@@ -23,8 +38,10 @@ enum button_function_t
 	BTN_FNC_LEFT,
 	BTN_FNC_RIGHT,
 	BTN_FNC_MIDDLE,
+	BTN_FNC_PRECISION, // Slow the pointer down while the button is held
 };
 
+// Values match the mode index of paw3395::set_mode()
 enum sensor_mode_t
 {
 	SENSOR_MODE_HIGH_PERFORMANCE,
@@ -42,9 +59,41 @@ struct app_config
 	uint8_t	 scroll_sensitivity					  = 100;
 	uint16_t dpi								  = 600;
 	uint16_t scroll_dpi							  = 800;
+	bool	 software_dpi						  = false; // Keep the sensor at sensor_dpi and scale motion in software
+	uint16_t sensor_dpi							  = 3200;  // Sensor resolution used with software_dpi
+	uint8_t	 dpi_y_percent						  = 100;   // Resolution of the sensor Y axis in percent of X
+	int16_t	 sensor_rotation					  = CONFIG_TRACKBALL_SENSOR_ROTATION;
+#ifdef CONFIG_TRACKBALL_SENSOR_FLIP_X
+	bool flip_x = true;
+#else
+	bool flip_x = false;
+#endif
+#ifdef CONFIG_TRACKBALL_SENSOR_FLIP_Y
+	bool flip_y = true;
+#else
+	bool flip_y = false;
+#endif
 	uint8_t	 sensor_mode						  = SENSOR_MODE_HIGH_PERFORMANCE;
+	uint16_t poll_rate							  = 125; // Sensor sampling rate: 125, 250, 500 or 1000 Hz
+	paw3395::power_config sensor_power;					 // Sensor rest modes
+	uint8_t	 min_squal							  = 16;	 // Motion is dropped below this surface quality, 0 - never
 	uint8_t	 scroll_mode						  = SCROLL_MODE_ENABLE_HSCROLL | SCROLL_MODE_ENABLE_VSCROLL;
 	bool	 enable_high_res_scroll				  = true;
+	bool	 scroll_axis_lock					  = true; // Scroll only the dominant axis when both are enabled
+	uint16_t scroll_axis_ratio					  = 200;  // Percent the dominant axis must lead by
+	bool	 momentum_scroll					  = true; // Keep scrolling after a flick in scroll lock
+	uint8_t	 momentum_friction					  = 4;	  // Percent of the coasting speed lost every 10 ms
+	uint16_t momentum_start_speed				  = 1500; // Counts per second a flick needs to coast
+	uint16_t momentum_stop_speed				  = 100;  // Counts per second at which coasting stops
+	bool	 jitter_filter						  = false; // Smooth the pointer at low speed
+	uint16_t jitter_min_cutoff					  = 100;   // Cutoff at rest, centi-Hz
+	uint16_t jitter_beta						  = 70;	   // Cutoff increase per 100 counts/s, centi-Hz
+	bool	 angle_snap							  = false; // Straighten near horizontal and vertical drags
+	uint8_t	 angle_snap_degrees					  = 8;	   // Largest deviation from an axis which is snapped
+	uint8_t	 precision_percent					  = 25;	   // Pointer speed while the precision button is held
+	uint16_t conn_idle_s						  = 5;	   // Idle time before slave latency is used, 0 - never
+	uint16_t conn_sleep_s						  = 60;	   // Idle time before a long connection interval is used, 0 - never
+	accel_config pointer_accel;									 // Pointer acceleration curve
 	uint16_t predefined_dpi[PREDEFINED_DPI_COUNT] = {200, 600, 1200, 2000};
 };
 
@@ -63,8 +112,28 @@ private:
 	app_config	 m_config;
 	app_state_t	 m_app_state			= APP_STATE_DEFAULT;
 
-	uint8_t m_buttons					= 0;
-	uint8_t m_locked_buttons			= 0;
+	// Scale in the sensor frame, like the sensor resolution, then turn to the host frame
+	using pointer_pipeline =
+		motion_pipeline<motion_scaler, jitter_filter, motion_accel, precision_scaler, motion_transform, angle_snap>;
+	using scroll_pipeline = motion_pipeline<motion_scaler, motion_transform, scroll_axis_lock>;
+
+	pointer_pipeline m_pointer_pipeline;
+	scroll_pipeline	 m_scroll_pipeline;
+	scroll_converter m_scroll_converter; // After the momentum, coasting is converted the same way
+	bool			 m_scrolling		= false; // Scroll state of the last processed motion
+	scroll_momentum	 m_momentum;
+	timer			 m_momentum_timer{"momentum"}; // Wakes the report task while coasting is possible
+	surface_telemetry m_telemetry;
+	motion_queue	  m_motion_queue; // Sensor task -> report task
+	TaskHandle_t	  m_report_task = nullptr;
+	uint32_t		  m_telemetry_seq = 0; // Last statistics sent to the UI and over BLE
+	bool			  m_report_refused = false; // The last report was not accepted, report task only
+
+	// Changed by the buttons task, reported by the report task which is the only writer of the mouse report
+	std::atomic<uint8_t> m_buttons{0};
+	std::atomic<uint8_t> m_locked_buttons{0};
+	std::atomic<bool>	 m_report_requested{false};
+	std::atomic<bool>	 m_motion_dpi_changed{false}; // Set by apply_dpi(), the report task updates the stages
 
 	// for nvs_storage
 	const char*	 m_nvs_namespace		= "storage";
@@ -74,6 +143,11 @@ private:
 	i2c_master_dev_handle_t m_h_i2c_dev = nullptr;
 
 	timer m_connection_state_timer{"connection_state"};
+#ifdef CONFIG_TRACKBALL_POWER_LOG
+	timer	m_power_log_timer{"power_log"};
+	int		m_power_log_voltage = 0;
+	int64_t m_power_log_time	= 0;
+#endif
 public:
 	app();
 	~app() = default;
@@ -82,22 +156,36 @@ public:
 	void deinit();
 
 	void on_connection_changed();
+	void on_notify_ready();
 
 private:
 	void apply_config();
-	void sensor_motion_callback(int16_t dx, int16_t dy);
+	void apply_dpi();
+	void apply_motion_dpi();
+	void benchmark_motion(uint32_t samples);
+	void		sensor_motion_callback(const paw3395::motion_data& data);
+	static void report_task(void* param);
+	void		process_motion(int32_t dx, int32_t dy, uint32_t samples);
+	void		process_held_motion(uint32_t dt_us);
+	bool		process_momentum();
+	void		send_scroll(int32_t x, int32_t y);
+	void		apply_scroll_config();
 	void on_btn_cfg_state_changed(button_state_t state);
 	void on_btn_cfg_clicked();
+	void on_btn_cfg_hold_down();
 	void on_btn_mode_clicked();
 	void on_btn_mode_hold_down();
 	void on_btn_scroll_state_changed(button_state_t state);
 	void on_btn_scroll_clicked();
 	void on_update_connection_state();
+	void update_telemetry();
 	void on_battery_state_changed(int voltage, int level);
+	void on_power_log();
 	void apply_button_function(button_state_t state, button_function_t func);
 
 	void set_app_state(app_state_t state);
-	void send_report(int16_t dx = 0, int16_t dy = 0, int16_t wheel = 0, int16_t ac_pan = 0);
+	void send_report(int32_t dx = 0, int32_t dy = 0, int32_t wheel = 0, int32_t ac_pan = 0);
+	void request_report();
 
 	uint8_t get_report_buttons() const
 	{
@@ -22,6 +22,14 @@ void hid_on_connection_changed()
 	g_app->on_connection_changed();
 }
 
+void hid_on_notify_ready()
+{
+	if(g_app)
+	{
+		g_app->on_notify_ready();
+	}
+}
+
 static void app_task(void* pvParameters)
 {
 	g_app = new app();
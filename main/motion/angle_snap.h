@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "motion_sample.h"
+
+/// @brief Pipeline stage straightening near horizontal and near vertical drags.
+/// The direction is taken from the motion of the last WINDOW samples. When it is within the snap
+/// angle of an axis, the motion is projected onto that axis and the motion across it is held back.
+/// Snapping disengages when the direction leaves twice the angle or when the drag ends, and the held
+/// motion is then released, so the pointer ends where the ball put it. The end of a drag is a pause
+/// of IDLE_US: while pending() the owner passes samples without motion, which notice the pause.
+class angle_snap
+{
+public:
+	static constexpr uint32_t WINDOW	 = 8;	   // Power of two
+	static constexpr int32_t  MIN_TRAVEL = 16;	   // Counts in the window needed to detect the direction
+	static constexpr int64_t  IDLE_US	 = 200000; // Pause which disengages snapping
+	static constexpr int	  Q			 = 8;
+
+	enum axis_t
+	{
+		AXIS_NONE,
+		AXIS_X,
+		AXIS_Y,
+	};
+private:
+	struct delta
+	{
+		int32_t x;
+		int32_t y;
+	};
+
+	bool	 m_enabled		  = false;
+	int32_t	 m_engage		  = 36; // tan(snap angle), Q8
+	int32_t	 m_disengage	  = 73; // tan(2 * snap angle), Q8
+	delta	 m_window[WINDOW] = {};
+	uint32_t m_pos			  = 0;
+	int64_t	 m_sum_x		  = 0; // Motion of the window
+	int64_t	 m_sum_y		  = 0;
+	axis_t	 m_axis			  = AXIS_NONE;
+	int32_t	 m_held			  = 0; // Motion across the snapped axis not reported yet
+	int64_t	 m_last			  = 0;
+public:
+	/// @param degrees Largest deviation from an axis which is snapped
+	void set(bool enabled, uint8_t degrees)
+	{
+		m_enabled	= enabled;
+		degrees		= degrees > 40 ? 40 : degrees;
+		m_engage	= (int32_t) lround(tan(degrees * M_PI / 180.0) * (1 << Q));
+		m_disengage = (int32_t) lround(tan(2 * degrees * M_PI / 180.0) * (1 << Q));
+		reset();
+	}
+
+	void reset()
+	{
+		for(delta& d : m_window)
+		{
+			d = {};
+		}
+		m_sum_x = 0;
+		m_sum_y = 0;
+		m_axis	= AXIS_NONE;
+		m_held	= 0;
+	}
+
+	axis_t axis() const
+	{
+		return m_axis;
+	}
+
+	/// @brief Motion across the snapped axis waits for the end of the drag
+	bool pending() const
+	{
+		return m_held != 0;
+	}
+
+	/// @brief End the drag, the held motion is added to the sample
+	void flush(motion_sample& s)
+	{
+		release(s);
+		reset();
+	}
+
+	void process(motion_sample& s)
+	{
+		if(!m_enabled)
+		{
+			return;
+		}
+		if(s.time - m_last > IDLE_US)
+		{
+			release(s);
+			reset();
+		}
+		if(s.x == 0 && s.y == 0)
+		{
+			// Samples without motion only measure the pause
+			return;
+		}
+		m_last = s.time;
+
+		// Slide the window
+		delta& old = m_window[m_pos & (WINDOW - 1)];
+		m_sum_x -= old.x;
+		m_sum_y -= old.y;
+		old.x = s.x;
+		old.y = s.y;
+		m_sum_x += old.x;
+		m_sum_y += old.y;
+		m_pos++;
+
+		int64_t ax = std::abs(m_sum_x);
+		int64_t ay = std::abs(m_sum_y);
+		switch(m_axis)
+		{
+		case AXIS_NONE:
+			if(ax >= MIN_TRAVEL && (ay << Q) <= ax * m_engage)
+			{
+				m_axis = AXIS_X;
+			} else if(ay >= MIN_TRAVEL && (ax << Q) <= ay * m_engage)
+			{
+				m_axis = AXIS_Y;
+			}
+			break;
+		case AXIS_X:
+			if((ay << Q) > ax * m_disengage)
+			{
+				release(s);
+			}
+			break;
+		case AXIS_Y:
+			if((ax << Q) > ay * m_disengage)
+			{
+				release(s);
+			}
+			break;
+		}
+
+		if(m_axis == AXIS_X)
+		{
+			m_held += s.y;
+			s.y = 0;
+		} else if(m_axis == AXIS_Y)
+		{
+			m_held += s.x;
+			s.x = 0;
+		}
+	}
+
+private:
+	/// @brief Stop snapping and add the held motion to the sample
+	void release(motion_sample& s)
+	{
+		if(m_axis == AXIS_X)
+		{
+			s.y += m_held;
+		} else if(m_axis == AXIS_Y)
+		{
+			s.x += m_held;
+		}
+		m_held = 0;
+		m_axis = AXIS_NONE;
+	}
+};
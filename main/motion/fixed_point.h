@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+/// @brief Whole counts of a fixed point value with Q fraction bits, the fraction is carried in rem.
+/// Floor division keeps the remainder in [0, 1) for both directions, so slow motion adds up to
+/// whole counts at the same rate either way and the total does not depend on how it was split.
+template <int Q>
+inline int32_t take_counts(int64_t value, int32_t& rem)
+{
+	int64_t acc = value + rem;
+	int64_t out = acc >> Q;
+	rem			= (int32_t) (acc - (out << Q));
+	return (int32_t) out;
+}
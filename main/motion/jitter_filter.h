@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "fixed_point.h"
+#include "motion_sample.h"
+
+/// @brief Adaptive low-pass filter of the pointer motion, after the 1 Euro filter.
+/// The pointer position is smoothed by an exponential filter whose cutoff grows with the speed:
+/// at rest the cutoff is min_cutoff and the sensor noise is removed, fast motion passes almost
+/// unchanged. Only the lag between the raw and the filtered position is kept, so the state stays
+/// bounded. When the motion stops the lag is still owed to the host: while pending() the owner
+/// passes samples without motion, which move the pointer the rest of the way.
+/// Fixed point: the lag is Q8 counts, smoothing factors Q16.
+class jitter_filter
+{
+public:
+	static constexpr int	 Q			 = 8;
+	static constexpr int	 ALPHA_SHIFT = 16;
+	static constexpr int64_t IDLE_US	 = 100000; // The speed estimate restarts after this pause
+private:
+	// 2 * pi in Q16
+	static constexpr int64_t TWO_PI_Q16 = 411775;
+
+	bool	 m_enabled	  = false;
+	uint32_t m_min_cutoff = 100; // Centi-Hz
+	uint32_t m_beta		  = 70;	 // Centi-Hz of cutoff per 100 counts/s
+	uint32_t m_d_cutoff	  = 100; // Cutoff of the speed estimate, centi-Hz
+
+	int32_t m_lag_x = 0; // Raw minus filtered position, Q8
+	int32_t m_lag_y = 0;
+	int32_t m_rem_x = 0; // Fraction of a count not reported yet, Q8
+	int32_t m_rem_y = 0;
+	int32_t m_speed = 0; // Filtered speed, counts per second
+	int64_t m_last	= 0; // Time of the previous sample
+public:
+	/// @param min_cutoff Cutoff at rest, centi-Hz
+	/// @param beta Cutoff increase per 100 counts/s, centi-Hz
+	void set(bool enabled, uint16_t min_cutoff, uint16_t beta)
+	{
+		m_enabled	 = enabled;
+		m_min_cutoff = std::max<uint16_t>(min_cutoff, 1);
+		m_beta		 = beta;
+		reset();
+	}
+
+	void reset()
+	{
+		m_lag_x = 0;
+		m_lag_y = 0;
+		m_rem_x = 0;
+		m_rem_y = 0;
+		m_speed = 0;
+	}
+
+	/// @brief The filtered position has not reached the raw one yet
+	bool pending() const
+	{
+		return m_lag_x != 0 || m_lag_y != 0;
+	}
+
+	/// @brief Pass the sample unfiltered together with the whole lag
+	void flush(motion_sample& s)
+	{
+		s.x		= take_counts<Q>(((int64_t) s.x << Q) + m_lag_x, m_rem_x);
+		s.y		= take_counts<Q>(((int64_t) s.y << Q) + m_lag_y, m_rem_y);
+		m_lag_x = 0;
+		m_lag_y = 0;
+	}
+
+	/// @param dt_us Time over which the motion was collected
+	void process(int32_t& dx, int32_t& dy, uint32_t dt_us)
+	{
+		if(!m_enabled)
+		{
+			return;
+		}
+		dt_us = std::max<uint32_t>(dt_us, 1);
+		bool drain = dx == 0 && dy == 0;
+
+		// Speed from the raw motion, smoothed with a fixed cutoff
+		uint32_t ax	   = (uint32_t) std::abs(dx);
+		uint32_t ay	   = (uint32_t) std::abs(dy);
+		uint32_t mag   = std::max(ax, ay) + ((std::min(ax, ay) * 3) >> 3);
+		int32_t	 speed = (int32_t) std::min<uint64_t>((uint64_t) mag * 1000000 / dt_us, INT32_MAX / 2);
+		int32_t	 a_d   = alpha(m_d_cutoff, dt_us);
+		m_speed += (int32_t) (((int64_t) (speed - m_speed) * a_d) >> ALPHA_SHIFT);
+
+		uint32_t cutoff = m_min_cutoff + (uint32_t) std::min<uint64_t>((uint64_t) m_beta * m_speed / 100, 100000);
+		int32_t	 a		= alpha(cutoff, dt_us);
+		dx				= filter(dx, a, m_lag_x, m_rem_x, drain);
+		dy				= filter(dy, a, m_lag_y, m_rem_y, drain);
+	}
+
+	void process(motion_sample& s)
+	{
+		if(s.time - m_last > IDLE_US)
+		{
+			m_speed = 0;
+		}
+		m_last = s.time;
+		process(s.x, s.y, s.dt_us);
+	}
+
+private:
+	/// @brief Smoothing factor of an exponential filter, dt / (dt + 1 / (2 pi fc))
+	/// @param cutoff Centi-Hz
+	/// @return Q16
+	static int32_t alpha(uint32_t cutoff, uint32_t dt_us)
+	{
+		// 2 pi fc dt in units of 1e-8 * Q16
+		int64_t w	= TWO_PI_Q16 * cutoff * dt_us;
+		int64_t one = (int64_t) 100000000 << ALPHA_SHIFT;
+		return (int32_t) (w / ((w + one) >> ALPHA_SHIFT));
+	}
+
+	/// @param drain Sample without motion, the lag below one count is released at once
+	static int32_t filter(int32_t value, int32_t a, int32_t& lag, int32_t& rem, bool drain)
+	{
+		int64_t e	= ((int64_t) value << Q) + lag;
+		int64_t out = (e * a) >> ALPHA_SHIFT;
+		if(drain && std::abs(e) < (1 << Q))
+		{
+			// The exponential tail would never reach zero in fixed point
+			out = e;
+		}
+		lag = (int32_t) std::clamp<int64_t>(e - out, INT32_MIN / 2, INT32_MAX / 2);
+		return take_counts<Q>(out, rem);
+	}
+};
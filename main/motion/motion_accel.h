@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include "fixed_point.h"
+#include "motion_sample.h"
+
+enum accel_curve_t
+{
+	ACCEL_CURVE_NONE,	 // Constant gain of 1
+	ACCEL_CURVE_LINEAR,	 // Gain grows linearly from offset to speed_cap
+	ACCEL_CURVE_NATURAL, // Gain approaches gain_max exponentially, reaching 95% at speed_cap
+	ACCEL_CURVE_SIGMOID, // Gain follows an S curve centered between offset and speed_cap
+	ACCEL_CURVE_CUSTOM,	 // Gain is interpolated between the points
+};
+
+/// @brief Pointer acceleration settings.
+/// Speeds are in tenths of an inch per second of ball travel, gains in percent.
+struct accel_config
+{
+	static constexpr int MAX_POINTS = 8;
+
+	struct point
+	{
+		uint16_t speed;
+		uint16_t gain;
+	};
+
+	uint8_t	 curve				= ACCEL_CURVE_NONE;
+	uint16_t offset				= 20;  // Speed below which the gain stays at 100%
+	uint16_t speed_cap			= 300; // Speed at which the gain reaches gain_max
+	uint16_t gain_max			= 300;
+	uint8_t	 points_count		= 0; // Points of ACCEL_CURVE_CUSTOM, sorted by speed
+	point	 points[MAX_POINTS] = {};
+};
+
+/// @brief Speed dependent gain applied to the pointer motion.
+/// The curve is sampled into a fixed point table by set(), out of the motion path. Per sample
+/// the speed is estimated with integer math, the gain is interpolated between two table entries
+/// and the part of a count which does not fit into the output is carried to the next sample.
+class motion_accel
+{
+public:
+	static constexpr int	 SHIFT		= 16;
+	static constexpr int32_t ONE		= 1 << SHIFT;
+	static constexpr int	 SPEED_Q	= 8;   // Speed fraction bits, the speed unit is inch per second
+	static constexpr int	 STEP_SHIFT = 7;   // Table step of 0.5 in/s
+	static constexpr int	 LUT_SIZE	= 129; // Covers 0..64 in/s, faster motion uses the last entry
+private:
+	int32_t	 m_lut[LUT_SIZE];	   // Gain, Q16
+	bool	 m_enabled	 = false;
+	uint32_t m_speed_num = 256000; // Converts counts per microsecond to in/s Q8, 256e6 / dpi
+	int32_t	 m_rem_x	 = 0;	   // Fraction of an output count, Q16
+	int32_t	 m_rem_y	 = 0;
+public:
+	motion_accel()
+	{
+		std::fill(std::begin(m_lut), std::end(m_lut), ONE);
+	}
+
+	/// @brief Sample the curve into the table. Not thread safe against process().
+	void set(const accel_config& cfg)
+	{
+		m_enabled = cfg.curve != ACCEL_CURVE_NONE;
+		for(int i = 0; i < LUT_SIZE; i++)
+		{
+			// Table speed in tenths of in/s, the config unit
+			float speed = (float) (i << STEP_SHIFT) * 10.0f / (1 << SPEED_Q);
+			float gain	= curve_gain(cfg, speed);
+			m_lut[i]	= (int32_t) lroundf(std::clamp(gain, 0.0f, 1000.0f) * ONE);
+		}
+		reset();
+	}
+
+	/// @brief Set the resolution of the counts passed to process(). Call from the thread running process().
+	void set_resolution(uint32_t dpi)
+	{
+		if(dpi != 0)
+		{
+			m_speed_num = (uint32_t) (256000000ULL / dpi);
+		}
+	}
+
+	/// @brief Drop the carried fraction
+	void reset()
+	{
+		m_rem_x = 0;
+		m_rem_y = 0;
+	}
+
+	/// @param dt_us Time over which the motion was collected
+	void process(int32_t& dx, int32_t& dy, uint32_t dt_us)
+	{
+		if(!m_enabled || (dx == 0 && dy == 0))
+		{
+			return;
+		}
+		int32_t gain = gain_at(speed(dx, dy, dt_us));
+		dx			 = take_counts<SHIFT>((int64_t) dx * gain, m_rem_x);
+		dy			 = take_counts<SHIFT>((int64_t) dy * gain, m_rem_y);
+	}
+
+	void process(motion_sample& s)
+	{
+		process(s.x, s.y, s.dt_us);
+	}
+
+	/// @brief Gain of the table at a speed
+	/// @param speed in/s, Q8
+	int32_t gain_at(uint32_t speed) const
+	{
+		uint32_t idx = speed >> STEP_SHIFT;
+		if(idx >= LUT_SIZE - 1)
+		{
+			return m_lut[LUT_SIZE - 1];
+		}
+		int32_t frac = (int32_t) (speed & ((1 << STEP_SHIFT) - 1));
+		int32_t g0	 = m_lut[idx];
+		int32_t g1	 = m_lut[idx + 1];
+		return g0 + (int32_t) (((int64_t) (g1 - g0) * frac) >> STEP_SHIFT);
+	}
+
+	/// @return in/s, Q8
+	uint32_t speed(int32_t dx, int32_t dy, uint32_t dt_us) const
+	{
+		uint32_t ax = (uint32_t) std::abs(dx);
+		uint32_t ay = (uint32_t) std::abs(dy);
+		// Magnitude as max + 3/8 min, within 7% of the euclidean length
+		uint32_t hi	 = std::max(ax, ay);
+		uint32_t lo	 = std::min(ax, ay);
+		uint64_t mag = hi + ((lo * 3) >> 3);
+		if(dt_us == 0)
+		{
+			dt_us = 1;
+		}
+		return (uint32_t) std::min<uint64_t>(mag * m_speed_num / dt_us, UINT32_MAX);
+	}
+
+private:
+	/// @param speed Tenths of in/s
+	/// @return Gain, 1.0 = unchanged
+	static float curve_gain(const accel_config& cfg, float speed)
+	{
+		float gain_max = cfg.gain_max / 100.0f;
+		float offset   = cfg.offset;
+		float range	   = std::max<float>(cfg.speed_cap - offset, 1.0f);
+		float x		   = speed - offset;
+		switch(cfg.curve)
+		{
+		case ACCEL_CURVE_LINEAR:
+			if(x <= 0)
+			{
+				return 1.0f;
+			}
+			return 1.0f + (gain_max - 1.0f) * std::min(x / range, 1.0f);
+
+		case ACCEL_CURVE_NATURAL:
+			if(x <= 0)
+			{
+				return 1.0f;
+			}
+			// exp(-3) ~ 5% left at speed_cap
+			return gain_max - (gain_max - 1.0f) * expf(-3.0f * x / range);
+
+		case ACCEL_CURVE_SIGMOID:
+		{
+			// 5% of the gain change at offset, 95% at speed_cap
+			float k = 2.0f * logf(19.0f) / range;
+			return 1.0f + (gain_max - 1.0f) / (1.0f + expf(-k * (x - range / 2.0f)));
+		}
+
+		case ACCEL_CURVE_CUSTOM:
+		{
+			int count = std::min<int>(cfg.points_count, accel_config::MAX_POINTS);
+			if(count == 0)
+			{
+				return 1.0f;
+			}
+			const accel_config::point* p = cfg.points;
+			if(speed <= p[0].speed)
+			{
+				return p[0].gain / 100.0f;
+			}
+			for(int i = 1; i < count; i++)
+			{
+				if(speed <= p[i].speed)
+				{
+					float t = (speed - p[i - 1].speed) / std::max(p[i].speed - p[i - 1].speed, 1);
+					return (p[i - 1].gain + t * (p[i].gain - p[i - 1].gain)) / 100.0f;
+				}
+			}
+			return p[count - 1].gain / 100.0f;
+		}
+
+		default:
+			return 1.0f;
+		}
+	}
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <tuple>
+#include "motion_sample.h"
+
+/// @brief Motion processing composed of stages at compile time.
+/// Every stage has process(motion_sample&) and reset(). The stages run in the order of the
+/// template arguments; the calls are resolved statically, so the compiler can inline the whole
+/// chain. A stage type may appear once per pipeline, it is reached by stage<T>().
+/// A stage which holds motion back after the ball stops also has pending(); while it returns true
+/// the owner keeps passing samples without motion at the sample rate, until the motion is out.
+/// Such a stage also has flush(motion_sample&), which adds all of the held motion to the sample at once,
+/// for when the motion must be out before the next sample, e.g. when the ball switches to scrolling.
+template <typename... Stages>
+class motion_pipeline
+{
+	std::tuple<Stages...> m_stages;
+public:
+	template <typename Stage>
+	Stage& stage()
+	{
+		return std::get<Stage>(m_stages);
+	}
+
+	void process(motion_sample& s)
+	{
+		std::apply([&s](Stages&... stages) { (stages.process(s), ...); }, m_stages);
+	}
+
+	/// @brief Some stage holds motion which was not output yet
+	bool pending() const
+	{
+		return std::apply([](const Stages&... stages) { return (stage_pending(stages) || ...); }, m_stages);
+	}
+
+	/// @brief Run a sample through the stages, the stages holding motion add all of it to the sample
+	void flush(motion_sample& s)
+	{
+		std::apply([&s](Stages&... stages) { (stage_flush(stages, s), ...); }, m_stages);
+	}
+
+	/// @brief Drop the state carried between samples by all stages
+	void reset()
+	{
+		std::apply([](Stages&... stages) { (stages.reset(), ...); }, m_stages);
+	}
+
+private:
+	template <typename Stage>
+	static bool stage_pending(const Stage& stage)
+	{
+		if constexpr(requires { stage.pending(); })
+		{
+			return stage.pending();
+		} else
+		{
+			return false;
+		}
+	}
+
+	template <typename Stage>
+	static void stage_flush(Stage& stage, motion_sample& s)
+	{
+		if constexpr(requires { stage.flush(s); })
+		{
+			stage.flush(s);
+		} else
+		{
+			stage.process(s);
+		}
+	}
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Lock-free single producer / single consumer queue of motion deltas.
+/// The sensor task pushes every sample and never waits for the consumer. When the
+/// ring is full, the deltas are added to an overflow accumulator instead, so no
+/// motion is lost. The consumer takes everything queued at once and merges it into
+/// one delta, so a slow radio results in fewer, larger reports rather than stale ones.
+class motion_queue
+{
+public:
+	static constexpr uint32_t SIZE = 64; // Power of two
+
+	struct stats
+	{
+		uint32_t pushed;	// Samples pushed by the producer
+		uint32_t coalesced; // Samples merged into a report with other samples
+		uint32_t overflows; // Samples added to the overflow accumulator because the ring was full
+		uint32_t depth;		// Samples waiting in the ring
+		uint32_t depth_max; // Highest number of samples waiting in the ring
+	};
+private:
+	struct delta
+	{
+		int16_t dx;
+		int16_t dy;
+	};
+
+	delta				  m_items[SIZE] = {};
+	std::atomic<uint32_t> m_head{0};	 // Next slot to write, owned by the producer
+	std::atomic<uint32_t> m_tail{0};	 // Next slot to read, owned by the consumer
+	std::atomic<int32_t>  m_overflow_x{0}; // Motion accumulated while the ring was full
+	std::atomic<int32_t>  m_overflow_y{0};
+	std::atomic<uint32_t> m_overflow_samples{0}; // Samples accumulated in the overflow
+
+	std::atomic<uint32_t> m_pushed{0};
+	std::atomic<uint32_t> m_coalesced{0};
+	std::atomic<uint32_t> m_overflows{0};
+	std::atomic<uint32_t> m_depth_max{0};
+public:
+	/// @brief Queue a delta. Called by the producer only.
+	void push(int16_t dx, int16_t dy)
+	{
+		uint32_t head  = m_head.load(std::memory_order_relaxed);
+		uint32_t depth = head - m_tail.load(std::memory_order_acquire);
+		m_pushed.store(m_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if(depth >= SIZE)
+		{
+			// The count is published last, a pop may take the motion of a sample before its count
+			m_overflow_x.fetch_add(dx, std::memory_order_relaxed);
+			m_overflow_y.fetch_add(dy, std::memory_order_relaxed);
+			m_overflow_samples.fetch_add(1, std::memory_order_release);
+			m_overflows.store(m_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return;
+		}
+		m_items[head & (SIZE - 1)] = {dx, dy};
+		m_head.store(head + 1, std::memory_order_release);
+		if(depth + 1 > m_depth_max.load(std::memory_order_relaxed))
+		{
+			m_depth_max.store(depth + 1, std::memory_order_relaxed);
+		}
+	}
+
+	/// @brief Take all queued deltas merged into one. Called by the consumer only.
+	/// @param samples Receives the number of sensor samples merged, it may be 0 with motion of
+	/// a sample which is just being added to the overflow, its count comes with the next call
+	/// @return false if nothing was queued
+	bool pop_all(int32_t& dx, int32_t& dy, uint32_t& samples)
+	{
+		uint32_t tail  = m_tail.load(std::memory_order_relaxed);
+		uint32_t head  = m_head.load(std::memory_order_acquire);
+		uint32_t count = head - tail;
+		dx			   = 0;
+		dy			   = 0;
+		for(; tail != head; tail++)
+		{
+			const delta& d = m_items[tail & (SIZE - 1)];
+			dx += d.dx;
+			dy += d.dy;
+		}
+		m_tail.store(tail, std::memory_order_release);
+
+		// Taken after the ring, the overflow holds the newest samples
+		uint32_t overflow_samples = m_overflow_samples.exchange(0, std::memory_order_acquire);
+		int32_t	 overflow_x		  = m_overflow_x.exchange(0, std::memory_order_relaxed);
+		int32_t	 overflow_y		  = m_overflow_y.exchange(0, std::memory_order_relaxed);
+		dx += overflow_x;
+		dy += overflow_y;
+		count += overflow_samples;
+		if(count > 1)
+		{
+			m_coalesced.fetch_add(count, std::memory_order_relaxed);
+		}
+		samples = count;
+		return count != 0 || dx != 0 || dy != 0;
+	}
+
+	stats get_stats() const
+	{
+		stats s		= {};
+		s.pushed	= m_pushed.load(std::memory_order_relaxed);
+		s.coalesced = m_coalesced.load(std::memory_order_relaxed);
+		s.overflows = m_overflows.load(std::memory_order_relaxed);
+		s.depth		= m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed);
+		s.depth_max = m_depth_max.load(std::memory_order_relaxed);
+		return s;
+	}
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+/// @brief Motion passed through the stages of a motion_pipeline
+struct motion_sample
+{
+	int32_t	 x; // Pointer motion, counts
+	int32_t	 y;
+	int32_t	 wheel; // Scroll units, produced by scroll_converter
+	int32_t	 ac_pan;
+	uint32_t dt_us; // Time over which the motion was collected
+	int64_t	 time;	// Time of the sample, microseconds
+};
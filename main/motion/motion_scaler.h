@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include "fixed_point.h"
+#include "motion_sample.h"
+
+/// @brief Scales motion counts by a fixed point factor.
+/// The part of a count which does not fit into the output is carried to the next sample,
+/// so slow movements are not lost and the total travel does not depend on the sample size.
+class motion_scaler
+{
+public:
+	static constexpr int	 SHIFT = 16;
+	static constexpr int32_t ONE   = 1 << SHIFT;
+private:
+	int32_t m_factor_x = ONE; // Q16
+	int32_t m_factor_y = ONE; // Q16
+	int32_t m_rem_x	   = 0;	  // Fraction of an output count, Q16
+	int32_t m_rem_y	   = 0;
+public:
+	/// @brief Set the scale as the ratio of two resolutions, e.g. target and sensor DPI
+	void set_ratio(uint32_t num_x, uint32_t num_y, uint32_t den)
+	{
+		if(den == 0)
+		{
+			return;
+		}
+		m_factor_x = (int32_t) (((uint64_t) num_x << SHIFT) / den);
+		m_factor_y = (int32_t) (((uint64_t) num_y << SHIFT) / den);
+	}
+
+	void set_ratio(uint32_t num, uint32_t den)
+	{
+		set_ratio(num, num, den);
+	}
+
+	/// @brief Drop the carried fraction
+	void reset()
+	{
+		m_rem_x = 0;
+		m_rem_y = 0;
+	}
+
+	void process(int32_t& dx, int32_t& dy)
+	{
+		dx = take_counts<SHIFT>((int64_t) dx * m_factor_x, m_rem_x);
+		dy = take_counts<SHIFT>((int64_t) dy * m_factor_y, m_rem_y);
+	}
+
+	void process(motion_sample& s)
+	{
+		process(s.x, s.y);
+	}
+};
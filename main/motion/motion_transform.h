@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "fixed_point.h"
+#include "motion_sample.h"
+
+/// @brief Rotates and mirrors motion from the sensor frame to the host frame.
+/// The 2x2 matrix is kept in fixed point, so a sample costs four multiplications.
+/// The fraction of a count lost by rounding is carried to the next sample.
+class motion_transform
+{
+public:
+	static constexpr int	 SHIFT = 14;
+	static constexpr int32_t ONE   = 1 << SHIFT;
+private:
+	int32_t m_xx	= ONE; // Q14
+	int32_t m_xy	= 0;
+	int32_t m_yx	= 0;
+	int32_t m_yy	= ONE;
+	int32_t m_rem_x = 0; // Fraction of an output count, Q14
+	int32_t m_rem_y = 0;
+public:
+	/// @brief Set the sensor orientation
+	/// @param rotation Counterclockwise rotation of the sensor in degrees
+	/// @param flip_x Mirror the X axis after the rotation
+	/// @param flip_y Mirror the Y axis after the rotation
+	void set(int rotation, bool flip_x, bool flip_y)
+	{
+		rotation %= 360;
+		if(rotation < 0)
+		{
+			rotation += 360;
+		}
+		int32_t c, s;
+		switch(rotation)
+		{
+		// Exact values for the right angles, the enclosures mount the sensor this way
+		case 0:
+			c = ONE;
+			s = 0;
+			break;
+		case 90:
+			c = 0;
+			s = ONE;
+			break;
+		case 180:
+			c = -ONE;
+			s = 0;
+			break;
+		case 270:
+			c = 0;
+			s = -ONE;
+			break;
+		default:
+		{
+			double rad = rotation * M_PI / 180.0;
+			c		   = (int32_t) lround(cos(rad) * ONE);
+			s		   = (int32_t) lround(sin(rad) * ONE);
+			break;
+		}
+		}
+		int32_t fx = flip_x ? -1 : 1;
+		int32_t fy = flip_y ? -1 : 1;
+		m_xx	   = fx * c;
+		m_xy	   = fx * -s;
+		m_yx	   = fy * s;
+		m_yy	   = fy * c;
+		reset();
+	}
+
+	/// @brief Drop the carried fraction
+	void reset()
+	{
+		m_rem_x = 0;
+		m_rem_y = 0;
+	}
+
+	void process(int32_t& dx, int32_t& dy)
+	{
+		// Merged motion may exceed 16 bits, the HID layer splits it over several reports
+		int64_t x = dx;
+		int64_t y = dy;
+		dx		  = take_counts<SHIFT>(x * m_xx + y * m_xy, m_rem_x);
+		dy		  = take_counts<SHIFT>(x * m_yx + y * m_yy, m_rem_y);
+	}
+
+	void process(motion_sample& s)
+	{
+		process(s.x, s.y);
+	}
+};
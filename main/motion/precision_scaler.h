@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "motion_sample.h"
+#include "motion_scaler.h"
+
+/// @brief Pipeline stage slowing the pointer down while a precision button is held.
+/// The button task only flips an atomic flag, the next sample is already scaled by the
+/// motion_scaler inside, which carries the fraction of a count, so slow moves still get through.
+class precision_scaler
+{
+	std::atomic<bool> m_active{false};
+	bool			  m_applied = false; // State of the previous sample, owned by the motion task
+	motion_scaler	  m_scaler;
+public:
+	precision_scaler()
+	{
+		set_ratio(25);
+	}
+
+	/// @param percent Speed of the pointer in precision mode
+	void set_ratio(uint8_t percent)
+	{
+		m_scaler.set_ratio(percent, 100);
+	}
+
+	void set_active(bool active)
+	{
+		m_active.store(active, std::memory_order_relaxed);
+	}
+
+	bool active() const
+	{
+		return m_active.load(std::memory_order_relaxed);
+	}
+
+	void reset()
+	{
+		m_scaler.reset();
+	}
+
+	void process(motion_sample& s)
+	{
+		bool active = m_active.load(std::memory_order_relaxed);
+		if(active != m_applied)
+		{
+			reset();
+			m_applied = active;
+		}
+		if(active)
+		{
+			m_scaler.process(s);
+		}
+	}
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+/// @brief Converts ball travel on one axis to wheel or AC pan units.
+/// One detent is counts_per_detent sensor counts and is reported as `multiplier` units,
+/// the resolution multiplier negotiated with the host. The part of a unit (or of a detent
+/// in low resolution mode) not reported yet is kept as an exact remainder, so slow rolls
+/// still scroll and the total scroll distance follows the ball travel.
+class scroll_axis
+{
+	int64_t m_acc = 0; // Travel not reported yet, in counts * multiplier (high resolution) or counts
+public:
+	/// @brief Drop the carried remainder
+	void reset()
+	{
+		m_acc = 0;
+	}
+
+	/// @param counts Ball travel since the previous sample
+	/// @param counts_per_detent Travel of one detent, scroll_sensitivity
+	/// @param multiplier Units reported per detent
+	/// @param high_res Report fractions of a detent, otherwise whole detents only
+	/// @return Units to report, may exceed the 16 bit report fields on fast flicks
+	int32_t process(int32_t counts, uint32_t counts_per_detent, uint32_t multiplier, bool high_res)
+	{
+		if(counts_per_detent == 0)
+		{
+			counts_per_detent = 1;
+		}
+		if(multiplier == 0)
+		{
+			multiplier = 1;
+		}
+		if(high_res)
+		{
+			m_acc += (int64_t) counts * multiplier;
+			// Truncation keeps the remainder symmetric for both directions
+			int64_t out = m_acc / counts_per_detent;
+			m_acc -= out * counts_per_detent;
+			return (int32_t) out;
+		}
+		m_acc += counts;
+		int64_t detents = m_acc / counts_per_detent;
+		m_acc -= detents * counts_per_detent;
+		return (int32_t) (detents * multiplier);
+	}
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include "motion_sample.h"
+
+/// @brief Keeps scrolling on the dominant axis.
+/// The travel of both axes is tracked with a short decaying window. Once one axis leads by
+/// `ratio`, the other one is suppressed. The lock moves only when the other axis leads by the
+/// same ratio, so the small pans leaking into a vertical roll never get through. After a pause
+/// the lock is released and the next roll picks its axis again.
+class scroll_axis_lock
+{
+public:
+	static constexpr int	 DECAY_SHIFT = 3;	   // Window of about 8 samples
+	static constexpr int	 Q			 = 4;	   // Fraction bits of the window sums
+	static constexpr int32_t MIN_TRAVEL	 = 8 << Q; // Travel needed to pick an axis
+	static constexpr int64_t IDLE_US	 = 300000; // Pause which releases the lock
+
+	enum axis_t
+	{
+		AXIS_NONE,
+		AXIS_X,
+		AXIS_Y,
+	};
+private:
+	int32_t	 m_sum_x   = 0; // Decaying travel, Q4
+	int32_t	 m_sum_y   = 0;
+	axis_t	 m_axis	   = AXIS_NONE;
+	int64_t	 m_last	   = 0;
+	uint32_t m_ratio   = 200; // Percent
+	bool	 m_enabled = true;
+public:
+	/// @param ratio_percent How much the dominant axis must lead, 100 - pick the larger one
+	void set(bool enabled, uint16_t ratio_percent)
+	{
+		m_enabled = enabled;
+		m_ratio	  = ratio_percent < 100 ? 100 : ratio_percent;
+	}
+
+	void reset()
+	{
+		m_sum_x = 0;
+		m_sum_y = 0;
+		m_axis	= AXIS_NONE;
+	}
+
+	axis_t axis() const
+	{
+		return m_axis;
+	}
+
+	void process(int32_t& x, int32_t& y, int64_t now)
+	{
+		if(now - m_last > IDLE_US)
+		{
+			reset();
+		}
+		m_last	= now;
+		m_sum_x = m_sum_x - (m_sum_x >> DECAY_SHIFT) + clamp_travel(x);
+		m_sum_y = m_sum_y - (m_sum_y >> DECAY_SHIFT) + clamp_travel(y);
+
+		if(m_axis != AXIS_Y && leads(m_sum_y, m_sum_x))
+		{
+			m_axis = AXIS_Y;
+		} else if(m_axis != AXIS_X && leads(m_sum_x, m_sum_y))
+		{
+			m_axis = AXIS_X;
+		}
+
+		if(m_axis == AXIS_Y)
+		{
+			x = 0;
+		} else if(m_axis == AXIS_X)
+		{
+			y = 0;
+		}
+	}
+
+	void process(motion_sample& s)
+	{
+		if(m_enabled)
+		{
+			process(s.x, s.y, s.time);
+		}
+	}
+
+private:
+	bool leads(int32_t a, int32_t b) const
+	{
+		return a >= MIN_TRAVEL && (int64_t) a * 100 >= (int64_t) b * m_ratio;
+	}
+
+	static int32_t clamp_travel(int32_t v)
+	{
+		// Keeps the sums far from overflow on fast flicks
+		uint32_t a = (uint32_t) std::abs(v);
+		return (int32_t) ((a > 0xFFFF ? 0xFFFF : a) << Q);
+	}
+};
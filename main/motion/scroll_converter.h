@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include "motion_sample.h"
+#include "scroll_axis.h"
+
+/// @brief Pipeline stage turning ball travel into wheel and AC pan units.
+/// Y drives the wheel and X the pan, the pointer motion of the sample is cleared.
+class scroll_converter
+{
+	scroll_axis	   m_wheel;
+	scroll_axis	   m_ac_pan;
+	uint8_t		   m_sensitivity  = 100;
+	bool		   m_enable_wheel = true;
+	bool		   m_enable_pan	  = true;
+	bool		   m_high_res	  = true;
+	bool		   m_applied_res  = true; // Mode the remainders were collected in
+	const uint8_t* m_multiplier	  = nullptr;
+public:
+	/// @param sensitivity Counts per detent
+	/// @param multiplier Resolution multiplier negotiated with the host, read on every sample
+	void set(uint8_t sensitivity, bool enable_wheel, bool enable_pan, bool high_res, const uint8_t* multiplier)
+	{
+		m_sensitivity  = sensitivity;
+		m_enable_wheel = enable_wheel;
+		m_enable_pan   = enable_pan;
+		m_high_res	   = high_res;
+		m_multiplier   = multiplier;
+	}
+
+	void reset()
+	{
+		m_wheel.reset();
+		m_ac_pan.reset();
+	}
+
+	void process(motion_sample& s)
+	{
+		bool	 high_res	= m_high_res;
+		uint32_t multiplier = m_multiplier ? *m_multiplier : 1;
+		if(high_res != m_applied_res)
+		{
+			// The remainders are in the units of the other mode
+			reset();
+			m_applied_res = high_res;
+		}
+		s.wheel	 = m_enable_wheel ? m_wheel.process(s.y, m_sensitivity, multiplier, high_res) : 0;
+		s.ac_pan = m_enable_pan ? m_ac_pan.process(s.x, m_sensitivity, multiplier, high_res) : 0;
+		s.x		 = 0;
+		s.y		 = 0;
+	}
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "fixed_point.h"
+
+/// @brief Keeps scrolling after the ball is flicked and released.
+/// The recent scroll samples are kept in a small ring. When no sample arrives for RELEASE_US,
+/// the release velocity is estimated from the samples of the last WINDOW_US, and step() then
+/// produces decaying motion on every tick until the velocity falls below the stop speed or the
+/// ball is touched again. The math is integer only, velocities are counts per ms in Q16.
+class scroll_momentum
+{
+public:
+	static constexpr int	  SHIFT		 = 16;
+	static constexpr uint32_t HISTORY	 = 8;	  // Power of two
+	static constexpr int64_t  WINDOW_US	 = 50000; // Samples used for the release velocity
+	static constexpr int64_t  RELEASE_US = 30000; // The ball is released after this time without motion
+	static constexpr int64_t  TICK_US	 = 10000; // Period the decay is specified for
+private:
+	struct sample
+	{
+		int32_t x;
+		int32_t y;
+		int64_t time;
+	};
+
+	sample	 m_history[HISTORY] = {};
+	uint32_t m_count			= 0; // Samples in the ring since the last release
+	bool	 m_coasting			= false;
+	int64_t	 m_last_step		= 0;
+	int32_t	 m_vx				= 0; // Q16 counts per ms
+	int32_t	 m_vy				= 0;
+	int32_t	 m_rem_x			= 0; // Fraction of a count, Q16
+	int32_t	 m_rem_y			= 0;
+
+	int32_t m_keep		  = 62259; // Velocity kept per tick, Q16
+	int32_t m_start_speed = 65536; // Q16 counts per ms
+	int32_t m_stop_speed  = 3277;
+public:
+	/// @param friction Percent of the velocity lost every TICK_US
+	/// @param start_speed Counts per second the ball must be flicked with to coast
+	/// @param stop_speed Counts per second below which coasting stops
+	void set(uint8_t friction, uint16_t start_speed, uint16_t stop_speed)
+	{
+		if(friction > 100)
+		{
+			friction = 100;
+		}
+		m_keep		  = (int32_t) ((100 - friction) * (1 << SHIFT) / 100);
+		m_start_speed = (int32_t) (((int64_t) start_speed << SHIFT) / 1000);
+		m_stop_speed  = (int32_t) (((int64_t) stop_speed << SHIFT) / 1000);
+	}
+
+	/// @brief Forget the history and stop coasting
+	void reset()
+	{
+		m_count	   = 0;
+		m_coasting = false;
+		m_vx	   = 0;
+		m_vy	   = 0;
+		m_rem_x	   = 0;
+		m_rem_y	   = 0;
+	}
+
+	bool coasting() const
+	{
+		return m_coasting;
+	}
+
+	/// @brief Record the motion of the ball, stops coasting
+	void add(int32_t x, int32_t y, int64_t now)
+	{
+		if(m_coasting)
+		{
+			reset();
+		}
+		m_history[m_count & (HISTORY - 1)] = {x, y, now};
+		m_count++;
+	}
+
+	/// @brief Advance the coasting, called periodically
+	/// @return true if x or y is not zero
+	bool step(int32_t& x, int32_t& y, int64_t now)
+	{
+		x = 0;
+		y = 0;
+		if(!m_coasting)
+		{
+			if(m_count == 0 || now - newest().time < RELEASE_US)
+			{
+				return false;
+			}
+			m_coasting	= estimate();
+			m_count		= 0;
+			m_last_step = now;
+			return false;
+		}
+
+		int64_t elapsed = now - m_last_step;
+		m_last_step		= now;
+		if(elapsed <= 0)
+		{
+			return false;
+		}
+		x = advance(m_vx, m_rem_x, elapsed);
+		y = advance(m_vy, m_rem_y, elapsed);
+
+		// One decay per tick, late ticks catch up
+		for(int64_t t = 0; t < elapsed; t += TICK_US)
+		{
+			m_vx = (int32_t) (((int64_t) m_vx * m_keep) >> SHIFT);
+			m_vy = (int32_t) (((int64_t) m_vy * m_keep) >> SHIFT);
+		}
+		if(std::abs(m_vx) < m_stop_speed && std::abs(m_vy) < m_stop_speed)
+		{
+			reset();
+		}
+		return x != 0 || y != 0;
+	}
+
+private:
+	const sample& newest() const
+	{
+		return m_history[(m_count - 1) & (HISTORY - 1)];
+	}
+
+	/// @brief Velocity over the samples of the last WINDOW_US before the release
+	bool estimate()
+	{
+		uint32_t	  available = m_count < HISTORY ? m_count : HISTORY;
+		const sample& last		= newest();
+		int64_t		  first		= last.time;
+		int64_t		  sum_x		= 0;
+		int64_t		  sum_y		= 0;
+		// The oldest sample in the window only marks the start, its motion happened before it
+		for(uint32_t i = 1; i < available; i++)
+		{
+			const sample& s = m_history[(m_count - 1 - i) & (HISTORY - 1)];
+			if(last.time - s.time > WINDOW_US)
+			{
+				break;
+			}
+			const sample& later = m_history[(m_count - i) & (HISTORY - 1)];
+			sum_x += later.x;
+			sum_y += later.y;
+			first = s.time;
+		}
+		int64_t span = last.time - first;
+		if(span <= 0)
+		{
+			return false;
+		}
+		m_vx	= velocity(sum_x, span);
+		m_vy	= velocity(sum_y, span);
+		m_rem_x = 0;
+		m_rem_y = 0;
+		if(std::abs(m_vx) < m_start_speed && std::abs(m_vy) < m_start_speed)
+		{
+			m_vx = 0;
+			m_vy = 0;
+			return false;
+		}
+		return true;
+	}
+
+	static int32_t velocity(int64_t counts, int64_t span_us)
+	{
+		return (int32_t) std::clamp<int64_t>(counts * (1 << SHIFT) * 1000 / span_us, -INT32_MAX / 2, INT32_MAX / 2);
+	}
+
+	static int32_t advance(int32_t v, int32_t& rem, int64_t elapsed_us)
+	{
+		return take_counts<SHIFT>((int64_t) v * elapsed_us / 1000, rem);
+	}
+};
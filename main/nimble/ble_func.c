@@ -9,6 +9,7 @@
 #include "esp_mac.h"
 #include "gatt_svr.h"
 #include "hid_func.h"
+#include "conn_params.h"
 
 #define MAC2STR_REV(a) (a)[5], (a)[4], (a)[3], (a)[2], (a)[1], (a)[0]
 
@@ -156,14 +157,7 @@ static int bleprph_gap_event(struct ble_gap_event* event, void* arg)
 			assert(rc == 0);
 			bleprph_print_conn_desc(&desc);
 
-			struct ble_gap_upd_params params = {
-				.itvl_min = 0x06, .itvl_max = 0x0A, .latency = 0, .supervision_timeout = 42};
-
-			int rc = ble_gap_update_params(event->connect.conn_handle, &params);
-			if(rc != 0)
-			{
-				ESP_LOGE(tag, "Update params error: %d", rc);
-			}
+			conn_params_connected(event->connect.conn_handle);
 			hid_clean_vars(&desc);
 
 		} else
@@ -175,6 +169,7 @@ static int bleprph_gap_event(struct ble_gap_event* event, void* arg)
 
 	case BLE_GAP_EVENT_DISCONNECT:
 		ESP_LOGI(tag, "disconnect; reason=%d ", event->disconnect.reason);
+		conn_params_disconnected();
 		hid_set_disconnected();
 
 		/* Connection terminated; resume advertising. */
@@ -189,6 +184,7 @@ static int bleprph_gap_event(struct ble_gap_event* event, void* arg)
 	case BLE_GAP_EVENT_CONN_UPDATE:
 		/* The central has updated the connection parameters. */
 		ESP_LOGI(tag, "connection updated; status=%d ", event->conn_update.status);
+		conn_params_updated(event->conn_update.conn_handle, event->conn_update.status);
 		return 0;
 
 	case BLE_GAP_EVENT_ADV_COMPLETE:
@@ -216,6 +212,8 @@ static int bleprph_gap_event(struct ble_gap_event* event, void* arg)
 		ESP_LOGD(tag, "notify event; status=%d conn_handle=%d attr_handle=%04X type=%s", event->notify_tx.status,
 				 event->notify_tx.conn_handle, event->notify_tx.attr_handle,
 				 event->notify_tx.indication ? "indicate" : "notify");
+		hid_notify_tx(event->notify_tx.conn_handle, event->notify_tx.attr_handle, event->notify_tx.status,
+					  event->notify_tx.indication);
 		return 0;
 
 	case BLE_GAP_EVENT_MTU:
@@ -0,0 +1,236 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "host/ble_gap.h"
+#include "conn_params.h"
+
+static const char* tag = "NimBLEKBD_CONNPARAMS";
+
+/* an update without BLE_GAP_EVENT_CONN_UPDATE is given up after this time */
+#define CONN_PENDING_TIMEOUT_US 10000000
+/* a step down refused by the central is not requested again before this time */
+#define CONN_RETRY_US			30000000
+
+/* supervision timeouts keep above (1 + latency) * itvl_max * 2 */
+static const struct ble_gap_upd_params Conn_levels[CONN_LEVEL_COUNT] = {
+	/* 7.5 - 12.5 ms, every event */
+	[CONN_LEVEL_ACTIVE] = {.itvl_min = 0x06, .itvl_max = 0x0A, .latency = 0, .supervision_timeout = 42},
+	/* 7.5 - 12.5 ms, the radio may skip 29 events while there is nothing to send */
+	[CONN_LEVEL_IDLE] = {.itvl_min = 0x06, .itvl_max = 0x0A, .latency = 29, .supervision_timeout = 100},
+	/* 60 - 75 ms, the radio may skip 4 events */
+	[CONN_LEVEL_SLEEP] = {.itvl_min = 0x30, .itvl_max = 0x3C, .latency = 4, .supervision_timeout = 200},
+};
+
+static const char* Conn_level_names[CONN_LEVEL_COUNT] = {"active", "idle", "sleep"};
+
+/* protected by Conn_lock */
+static struct conn_params_state
+{
+	bool	 connected;
+	uint16_t conn_handle;
+	bool	 pending;		// update requested, waiting for BLE_GAP_EVENT_CONN_UPDATE
+	uint8_t	 prev_level;	// level before the pending request
+	int64_t	 request_time;	// microseconds
+	int64_t	 retry_time;	// step downs are not requested before this time
+	int64_t	 last_activity; // microseconds
+	int64_t	 wake_time;		// first activity while not active, 0 - no report is awaited
+	uint32_t idle_ms;
+	uint32_t sleep_ms;
+	struct conn_params_stats stats;
+} Conn = {
+	.idle_ms  = 5000,
+	.sleep_ms = 60000,
+};
+
+static portMUX_TYPE Conn_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* level wanted after the idle time, Conn_lock must be held */
+static uint8_t conn_params_wanted(int64_t now)
+{
+	int64_t idle_us = now - Conn.last_activity;
+	if(Conn.sleep_ms && idle_us >= (int64_t) Conn.sleep_ms * 1000)
+		return CONN_LEVEL_SLEEP;
+	if(Conn.idle_ms && idle_us >= (int64_t) Conn.idle_ms * 1000)
+		return CONN_LEVEL_IDLE;
+	return CONN_LEVEL_ACTIVE;
+}
+
+/* start the update procedure, only one runs at a time */
+static void conn_params_request(uint8_t level)
+{
+	int64_t now = esp_timer_get_time();
+
+	taskENTER_CRITICAL(&Conn_lock);
+	if(!Conn.connected || Conn.pending || Conn.stats.level == level)
+	{
+		taskEXIT_CRITICAL(&Conn_lock);
+		return;
+	}
+	uint16_t conn_handle = Conn.conn_handle;
+	Conn.pending		 = true;
+	Conn.prev_level		 = Conn.stats.level;
+	Conn.stats.level	 = level;
+	Conn.request_time	 = now;
+	taskEXIT_CRITICAL(&Conn_lock);
+
+	int rc = ble_gap_update_params(conn_handle, &Conn_levels[level]);
+	if(rc != 0)
+	{
+		ESP_LOGE(tag, "Update params error: %d", rc);
+		taskENTER_CRITICAL(&Conn_lock);
+		Conn.pending	 = false;
+		Conn.stats.level = Conn.prev_level;
+		Conn.retry_time	 = now + CONN_RETRY_US;
+		Conn.stats.failures++;
+		taskEXIT_CRITICAL(&Conn_lock);
+		return;
+	}
+	ESP_LOGI(tag, "requesting %s connection parameters", Conn_level_names[level]);
+}
+
+void conn_params_connected(uint16_t conn_handle)
+{
+	taskENTER_CRITICAL(&Conn_lock);
+	Conn.connected	   = true;
+	Conn.conn_handle   = conn_handle;
+	Conn.pending	   = false;
+	Conn.retry_time	   = 0;
+	Conn.last_activity = esp_timer_get_time();
+	Conn.wake_time	   = 0;
+	memset(&Conn.stats, 0, sizeof(Conn.stats));
+	/* the central picked the parameters, request the active ones */
+	Conn.stats.level = CONN_LEVEL_COUNT;
+	taskEXIT_CRITICAL(&Conn_lock);
+
+	conn_params_request(CONN_LEVEL_ACTIVE);
+}
+
+void conn_params_disconnected(void)
+{
+	taskENTER_CRITICAL(&Conn_lock);
+	Conn.connected = false;
+	Conn.pending   = false;
+	taskEXIT_CRITICAL(&Conn_lock);
+}
+
+void conn_params_updated(uint16_t conn_handle, int status)
+{
+	struct ble_gap_conn_desc desc;
+	bool					 found = ble_gap_conn_find(conn_handle, &desc) == 0;
+	int64_t					 now   = esp_timer_get_time();
+
+	taskENTER_CRITICAL(&Conn_lock);
+	if(!Conn.connected || conn_handle != Conn.conn_handle)
+	{
+		taskEXIT_CRITICAL(&Conn_lock);
+		return;
+	}
+	/* the central may update the parameters on its own, only our requests are timed */
+	if(Conn.pending)
+	{
+		Conn.pending = false;
+		if(status == 0)
+		{
+			uint32_t elapsed		  = (uint32_t) (now - Conn.request_time);
+			Conn.stats.renegotiate_us = elapsed;
+			if(elapsed > Conn.stats.renegotiate_max_us)
+				Conn.stats.renegotiate_max_us = elapsed;
+			Conn.stats.updates++;
+		} else
+		{
+			Conn.stats.level = Conn.prev_level;
+			Conn.retry_time	 = now + CONN_RETRY_US;
+			Conn.stats.failures++;
+		}
+	}
+	if(found)
+	{
+		Conn.stats.itvl	   = desc.conn_itvl;
+		Conn.stats.latency = desc.conn_latency;
+	}
+	/* activity may have arrived while a step down was negotiated */
+	uint8_t level	= Conn.stats.level;
+	uint8_t wanted	= conn_params_wanted(now);
+	bool	request = wanted < level || (wanted > level && now >= Conn.retry_time);
+	taskEXIT_CRITICAL(&Conn_lock);
+
+	ESP_LOGI(tag, "connection parameters: status %d, itvl %d, latency %d", status, found ? desc.conn_itvl : 0,
+			 found ? desc.conn_latency : 0);
+	if(request)
+	{
+		conn_params_request(wanted);
+	}
+}
+
+void conn_params_set_idle(uint32_t idle_ms, uint32_t sleep_ms)
+{
+	taskENTER_CRITICAL(&Conn_lock);
+	Conn.idle_ms  = idle_ms;
+	Conn.sleep_ms = sleep_ms;
+	taskEXIT_CRITICAL(&Conn_lock);
+}
+
+void conn_params_activity(void)
+{
+	int64_t now = esp_timer_get_time();
+
+	taskENTER_CRITICAL(&Conn_lock);
+	Conn.last_activity = now;
+	bool wake		   = Conn.connected && Conn.stats.level != CONN_LEVEL_ACTIVE;
+	if(wake && Conn.wake_time == 0)
+		Conn.wake_time = now;
+	taskEXIT_CRITICAL(&Conn_lock);
+
+	if(wake)
+	{
+		conn_params_request(CONN_LEVEL_ACTIVE);
+	}
+}
+
+void conn_params_report_sent(void)
+{
+	taskENTER_CRITICAL(&Conn_lock);
+	if(Conn.wake_time)
+	{
+		uint32_t elapsed			   = (uint32_t) (esp_timer_get_time() - Conn.wake_time);
+		Conn.stats.wake_latency_us = elapsed;
+		if(elapsed > Conn.stats.wake_latency_max_us)
+			Conn.stats.wake_latency_max_us = elapsed;
+		Conn.wake_time = 0;
+	}
+	taskEXIT_CRITICAL(&Conn_lock);
+}
+
+void conn_params_tick(void)
+{
+	int64_t now = esp_timer_get_time();
+
+	taskENTER_CRITICAL(&Conn_lock);
+	if(Conn.pending && now - Conn.request_time > CONN_PENDING_TIMEOUT_US)
+	{
+		/* the update event was lost, let the next request through */
+		Conn.pending	 = false;
+		Conn.stats.level = Conn.prev_level;
+		Conn.stats.failures++;
+	}
+	uint8_t wanted	= conn_params_wanted(now);
+	bool	request = Conn.connected && !Conn.pending && wanted > Conn.stats.level && now >= Conn.retry_time;
+	taskEXIT_CRITICAL(&Conn_lock);
+
+	if(request)
+	{
+		conn_params_request(wanted);
+	}
+}
+
+void conn_params_get_stats(struct conn_params_stats* stats)
+{
+	taskENTER_CRITICAL(&Conn_lock);
+	*stats = Conn.stats;
+	taskEXIT_CRITICAL(&Conn_lock);
+}
@@ -0,0 +1,47 @@
+#ifndef H_CONN_PARAMS_
+#define H_CONN_PARAMS_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/* connection parameter sets, from the most responsive to the most power saving */
+	enum conn_params_level
+	{
+		CONN_LEVEL_ACTIVE, // shortest interval, no slave latency
+		CONN_LEVEL_IDLE,   // shortest interval with slave latency, reports still go out on the next event
+		CONN_LEVEL_SLEEP,  // long interval with slave latency, a renegotiation is needed before reporting fast
+		CONN_LEVEL_COUNT,
+	};
+
+	struct conn_params_stats
+	{
+		uint8_t	 level;				 // Level requested last, enum conn_params_level
+		uint16_t itvl;				 // Interval in use, 1.25 ms units
+		uint16_t latency;			 // Slave latency in use
+		uint32_t updates;			 // Completed parameter updates
+		uint32_t failures;			 // Updates refused by the host or the central
+		uint32_t renegotiate_us;	 // Time from the request to the update event of the last update
+		uint32_t renegotiate_max_us; // Longest renegotiation
+		uint32_t wake_latency_us;	 // Time from the first activity after idle to the first report sent
+		uint32_t wake_latency_max_us;
+	};
+
+	void conn_params_connected(uint16_t conn_handle);
+	void conn_params_disconnected(void);
+	void conn_params_updated(uint16_t conn_handle, int status); // BLE_GAP_EVENT_CONN_UPDATE
+	void conn_params_set_idle(uint32_t idle_ms, uint32_t sleep_ms); // 0 - never enter the level
+	void conn_params_activity(void);							// motion or buttons, returns to CONN_LEVEL_ACTIVE
+	void conn_params_report_sent(void);							// a report left the controller
+	void conn_params_tick(void);								// steps down after the idle periods, call periodically
+	void conn_params_get_stats(struct conn_params_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -279,6 +279,25 @@ int ble_svc_battery_access(uint16_t conn_handle, uint16_t attr_handle, struct bl
 	return rc;
 }
 
+/**
+ * Telemetry service access function
+ */
+int ble_svc_telemetry_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt* ctxt, void* arg)
+{
+	int rc = BLE_ATT_ERR_UNLIKELY;
+
+	if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR)
+	{
+		rc = hid_read_buffer(ctxt->om, (int) arg);
+		if(rc)
+		{
+			rc = BLE_ATT_ERR_INSUFFICIENT_RES;
+		}
+	}
+
+	return rc;
+}
+
 /**
  * Simple read access callback for the device information service
  * characteristic.
@@ -387,6 +406,8 @@ void gatt_svr_register_cb(struct ble_gatt_register_ctxt* ctxt, void* arg)
 		ESP_LOGI("charact", "uuid16 %s arg %d def_handle=%d (%04X) val_handle=%d (%04X)",
 				 ble_uuid_to_str(ctxt->chr.chr_def->uuid, buf), (int) ctxt->chr.chr_def->arg, ctxt->chr.def_handle,
 				 ctxt->chr.def_handle, ctxt->chr.val_handle, ctxt->chr.val_handle);
+		// Svc_char_handles is filled in by now, map the new handle to its report
+		hid_build_report_tables();
 		break;
 
 	case BLE_GATT_REGISTER_OP_DSC:
@@ -411,6 +432,8 @@ int gatt_svr_init(void)
 
 	do
 	{
+		BREAK_IF_NOT_ZERO(rc = hid_init());
+
 		BREAK_IF_NOT_ZERO(rc = ble_gatts_count_cfg(Gatt_svr_included_services));
 
 		BREAK_IF_NOT_ZERO(rc = ble_gatts_add_svcs(Gatt_svr_included_services));
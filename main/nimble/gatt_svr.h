@@ -58,6 +58,12 @@ extern "C"
 #define GATT_UUID_HID_PROTO_MODE			  0x2A4E
 #define GATT_UUID_HID_BT_MOUSE_INPUT		  0x2A33
 
+// Vendor service with the sensor telemetry
+#define GATT_UUID_TELEMETRY_SERVICE                                                                                    \
+	0x7b, 0x1c, 0x5e, 0x21, 0x93, 0x4a, 0x4f, 0x6d, 0x8e, 0x02, 0x3c, 0x5b, 0x00, 0x10, 0x7a, 0x3e
+#define GATT_UUID_TELEMETRY_SURFACE                                                                                    \
+	0x7b, 0x1c, 0x5e, 0x21, 0x93, 0x4a, 0x4f, 0x6d, 0x8e, 0x02, 0x3c, 0x5b, 0x01, 0x10, 0x7a, 0x3e
+
 #define GATT_UUID_BAT_PRESENT_DESCR			  0x2904
 #define GATT_UUID_EXT_RPT_REF_DESCR			  0x2907
 #define GATT_UUID_RPT_REF_DESCR				  0x2908
@@ -197,7 +203,10 @@ extern "C"
 		HANDLE_HID_MOUSE_REPORT,	  // 13
 		HANDLE_HID_BOOT_MOUSE_REPORT, // 19
 		HANDLE_HID_FEATURE_REPORT,	  // 20
-		HANDLE_HID_COUNT			  // 21
+
+		// TELEMETRY SERVICE
+		HANDLE_TELEMETRY_SURFACE,	  // 21
+		HANDLE_HID_COUNT			  // 22
 	};
 
 	struct report_reference_table
@@ -218,6 +227,10 @@ extern "C"
 	int ble_svc_battery_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt* ctxt,
 							   void* arg);
 
+	/* Access function for the telemetry service */
+	int ble_svc_telemetry_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt* ctxt,
+								 void* arg);
+
 	/* Access function for device information service */
 	int ble_svc_dis_access(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt* ctxt, void* arg);
 
@@ -301,6 +301,27 @@ const struct ble_gatt_svc_def Gatt_svr_svcs[] = {
 				}},
 	 },
 
+	{
+		/*** Telemetry Service */
+		.type	  = BLE_GATT_SVC_TYPE_PRIMARY,
+		.uuid	  = BLE_UUID128_DECLARE(GATT_UUID_TELEMETRY_SERVICE),
+		.includes = NULL,
+		.characteristics =
+			(struct ble_gatt_chr_def[]) {
+				{
+					/*** Surface quality and shutter statistics */
+					.uuid		= BLE_UUID128_DECLARE(GATT_UUID_TELEMETRY_SURFACE),
+					.access_cb	= ble_svc_telemetry_access,
+					.arg		= (void*) HANDLE_TELEMETRY_SURFACE,
+					.val_handle = &Svc_char_handles[HANDLE_TELEMETRY_SURFACE],
+					.flags		= BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+					NO_DESCR_MKS,
+				},
+				{
+					0, /* No more characteristics in this service. */
+				}},
+	 },
+
 	{
 		0, /* No more services. */
 	},
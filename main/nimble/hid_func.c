@@ -2,97 +2,160 @@
 #include "esp_log.h"
 
 #include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
 #include <freertos/queue.h>
 
+#include "esp_timer.h"
 #include "gatt_svr.h"
 #include "hid_func.h"
+#include "conn_params.h"
+#include "motion_accum.h"
+#include "report_buffer.h"
 
 static const char* tag = "NimBLEKBD_HIDFUNC";
 
-/*
-10 ms is enough time for writing operation, and
-a very large amount of time im terms of ble operations*/
-#define HID_DEV_BUF_MUTEX_WAIT 10
 #define BATTERY_DEFAULT_LEVEL  77
+/* room for the HCI ACL, L2CAP and ATT headers the host prepends to the report */
+#define HID_MBUF_LEADING_SPACE 16
+#define HID_MBUF_BLOCK_SIZE \
+	(sizeof(struct os_mbuf) + sizeof(struct os_mbuf_pkthdr) + HID_MBUF_LEADING_SPACE + REPORT_BUFFER_MAX)
 
-/* notify data buffers */
+/* preallocated transmit mbufs, reports are built in place and no heap or msys block is used per report.
+The host keeps an ACL packet until the controller has a free buffer for it, so a block comes back to
+the pool only when the controller took the packet, see hid_mbuf_put() */
+static os_membuf_t			Hid_mbuf_mem[OS_MEMPOOL_SIZE(HID_MBUF_COUNT, HID_MBUF_BLOCK_SIZE)];
+static struct os_mempool_ext Hid_mempool;
+static struct os_mbuf_pool	Hid_mbuf_pool;
+
+/* notify data buffers, see report_buffer.h */
 
 /* mouse: byte 0: bit 0 Button 1, bit 1 Button 2, bit 2 Button 3, bits 4 to 7 zero
 byte 1 : X displacement, byte 2: Y displacement, byte 3: wheel    */
-static uint8_t Mouse_buffer[HIDD_LE_REPORT_MOUSE_SIZE];
+static struct report_buffer Mouse_buffer = REPORT_BUFFER_INIT(0);
+/* motion not delivered to the host yet, protected by Mouse_pending_lock */
+static struct motion_accum Mouse_pending;
+static portMUX_TYPE		   Mouse_pending_lock = portMUX_INITIALIZER_UNLOCKED;
+/* the last mouse report was not delivered, its buttons are sent again even without motion */
+static bool Mouse_report_pending;
 /* battery level */
-static uint8_t Battery_level[] = {
-	BATTERY_DEFAULT_LEVEL
-};
+static struct report_buffer Battery_level = REPORT_BUFFER_INIT(BATTERY_DEFAULT_LEVEL);
+/* surface telemetry: SQUAL avg, min, max, raw data sum avg, shutter avg (LE),
+samples (LE), suppressed samples (LE) */
+static struct report_buffer Telemetry_buffer = REPORT_BUFFER_INIT(0);
 /* Feature report (1 byte) maps to Resolution Multiplier field from report descriptor. */
 uint8_t resolution_multiplier = 1;
-static uint8_t Feature_buffer[]		 = {1};
+static struct report_buffer Feature_buffer = REPORT_BUFFER_INIT(1);
+
+_Static_assert(HIDD_LE_REPORT_MOUSE_SIZE <= REPORT_BUFFER_MAX && HIDD_LE_TELEMETRY_SIZE <= REPORT_BUFFER_MAX,
+			   "report does not fit into report_buffer");
 
 static struct hid_notify_data
 {
 	const char* name;
 	int			handle_num;		 // handle index from Svc_char_handles
 	int			handle_boot_num; // handle num in boot mode
-	uint8_t*	buffer;			 // data to send
+	struct report_buffer* buffer; // data to send
 	size_t		buffer_size;
 	bool		can_indicate; // preffered method, because central will response to it
 	bool		can_notify;
+	uint16_t	attr_handle; // attribute handle of the current protocol mode, see hid_build_report_tables()
 } Notify_data_reports[] = {
 	{.name			  = "mouse",
 	 .handle_num	  = HANDLE_HID_MOUSE_REPORT,
 	 .handle_boot_num = HANDLE_HID_BOOT_MOUSE_REPORT,
-	 .buffer		  = Mouse_buffer,
+	 .buffer		  = &Mouse_buffer,
 	 .buffer_size	  = HIDD_LE_REPORT_MOUSE_SIZE,
 	 .can_indicate	  = false,
 	 .can_notify	  = false},
 	{.name			  = "battery level",
 	 .handle_num	  = HANDLE_BATTERY_LEVEL,
 	 .handle_boot_num = HANDLE_BATTERY_LEVEL,
-	 .buffer		  = Battery_level,
+	 .buffer		  = &Battery_level,
 	 .buffer_size	  = HIDD_LE_BATTERY_LEVEL_SIZE,
 	 .can_indicate	  = false,
 	 .can_notify	  = false},
 	{.name			  = "feature",
 	 .handle_num	  = HANDLE_HID_FEATURE_REPORT,
 	 .handle_boot_num = HANDLE_HID_FEATURE_REPORT,
-	 .buffer		  = Feature_buffer,
+	 .buffer		  = &Feature_buffer,
 	 .buffer_size	  = HIDD_LE_REPORT_FEATURE,
 	 .can_indicate	  = false,
 	 .can_notify	  = false},
+	{.name			  = "telemetry",
+	 .handle_num	  = HANDLE_TELEMETRY_SURFACE,
+	 .handle_boot_num = HANDLE_TELEMETRY_SURFACE,
+	 .buffer		  = &Telemetry_buffer,
+	 .buffer_size	  = HIDD_LE_TELEMETRY_SIZE,
+	 .can_indicate	  = false,
+	 .can_notify	  = false},
 };
 
+#define REPORTS_COUNT (sizeof(Notify_data_reports) / sizeof(Notify_data_reports[0]))
+
+/* attribute handles are assigned sequentially from 1 and stay far below this */
+#define HID_ATTR_HANDLE_MAX 256
+
+/* direct index tables to the Notify_data_reports slot, -1 if the handle is not a report */
+static int8_t Report_by_num[HANDLE_HID_COUNT];	 // handle number of either protocol mode
+static int8_t Report_by_attr[HID_ATTR_HANDLE_MAX]; // attribute handle of the current protocol mode
+
+static inline int report_slot_by_num(int handle_num)
+{
+	return (unsigned) handle_num < HANDLE_HID_COUNT ? Report_by_num[handle_num] : -1;
+}
+
+static inline int report_slot_by_attr(uint16_t attr_handle)
+{
+	return attr_handle < HID_ATTR_HANDLE_MAX ? Report_by_attr[attr_handle] : -1;
+}
+
 static struct hid_device_data
 {
-	/* Mutex semaphore for access to this struct */
-	SemaphoreHandle_t semaphore;
 	bool			  suspended_state;
 	bool			  report_mode_boot;
 	bool			  connected;
 	uint16_t		  conn_handle;
+	/* notification flow control of the connection, protected by Flow_lock */
+	struct hid_flow_stats flow;
+	bool				  flow_waiting; // a report was refused for the lack of a credit or an mbuf
 } My_hid_dev = {
-	.semaphore		  = 0,
 	.connected		  = false,
 	.suspended_state  = false,
 	.report_mode_boot = false,
 };
 
-/* mark report for indicate/notify when central subscribes to service charachetric with report */
-void hid_set_notify(uint16_t attr_handle, uint8_t cur_notify, uint8_t cur_indicate)
+static portMUX_TYPE Flow_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* map the handle numbers and the attribute handles of the current protocol mode to report slots,
+called when the attributes are registered and when the protocol mode changes */
+void hid_build_report_tables(void)
 {
-	int report_idx = -1;
+	memset(Report_by_num, -1, sizeof(Report_by_num));
+	memset(Report_by_attr, -1, sizeof(Report_by_attr));
 
-	/* find hid_notify_data struct index of reports array for given atribute handle */
-	for(int i = 0; i < sizeof(Notify_data_reports) / sizeof(Notify_data_reports[0]); ++i)
+	for(int i = 0; i < REPORTS_COUNT; ++i)
 	{
-		uint16_t current_handle_idx =
-			My_hid_dev.report_mode_boot ? Notify_data_reports[i].handle_boot_num : Notify_data_reports[i].handle_num;
-		if(attr_handle == Svc_char_handles[current_handle_idx])
+		struct hid_notify_data* report = &Notify_data_reports[i];
+		Report_by_num[report->handle_num]	   = i;
+		Report_by_num[report->handle_boot_num] = i;
+
+		int num				= My_hid_dev.report_mode_boot ? report->handle_boot_num : report->handle_num;
+		report->attr_handle = Svc_char_handles[num];
+		if(report->attr_handle >= HID_ATTR_HANDLE_MAX)
 		{
-			report_idx = i;
-			break;
+			ESP_LOGE(tag, "%s: attr_handle %d of %s is out of the table", __FUNCTION__, report->attr_handle,
+					 report->name);
+		} else if(report->attr_handle != 0)
+		{
+			Report_by_attr[report->attr_handle] = i;
 		}
 	}
+}
+
+/* mark report for indicate/notify when central subscribes to service charachetric with report */
+void hid_set_notify(uint16_t attr_handle, uint8_t cur_notify, uint8_t cur_indicate)
+{
+	/* find hid_notify_data struct index of reports array for given atribute handle */
+	int report_idx = report_slot_by_attr(attr_handle);
 	if(report_idx == -1)
 	{
 		ESP_LOGW(tag, "%s: attr_handle %04X not found in reports", __FUNCTION__, attr_handle);
@@ -106,82 +169,52 @@ void hid_set_notify(uint16_t attr_handle, uint8_t cur_notify, uint8_t cur_indica
 	}
 }
 
-/* lock report buffers with mutex semaphore */
-static int lock_hid_data()
-{
-	if(!My_hid_dev.semaphore)
-	{
-		ESP_LOGW(tag, "%s semaphore is NULL", __FUNCTION__);
-		return 1;
-	}
-	if(xSemaphoreTake(My_hid_dev.semaphore, pdMS_TO_TICKS(HID_DEV_BUF_MUTEX_WAIT)) == pdTRUE)
-	{
-		return 0;
-	} else
-	{
-		ESP_LOGW(tag, "%s: can't lock", __FUNCTION__);
-	}
-
-	return 2;
-}
+static os_error_t hid_mbuf_put(struct os_mempool_ext* mpe, void* data, void* arg);
 
-/* unlock report buffers locked with mutex semaphore */
-static int unlock_hid_data()
+/* prepare the report transmit pool, called once before the host starts */
+int hid_init(void)
 {
-	if(!My_hid_dev.semaphore)
+	int rc = os_mempool_ext_init(&Hid_mempool, HID_MBUF_COUNT, HID_MBUF_BLOCK_SIZE, Hid_mbuf_mem, "hid_mbuf");
+	if(rc == 0)
 	{
-		ESP_LOGW(tag, "%s semaphore is NULL", __FUNCTION__);
-		return 1;
+		Hid_mempool.mpe_put_cb = hid_mbuf_put;
+		rc = os_mbuf_pool_init(&Hid_mbuf_pool, &Hid_mempool.mpe_mp, HID_MBUF_BLOCK_SIZE, HID_MBUF_COUNT);
 	}
-	if(xSemaphoreGive(My_hid_dev.semaphore) == pdTRUE)
+	if(rc)
 	{
-		return 0;
+		ESP_LOGE(tag, "%s: mbuf pool init failed %d", __FUNCTION__, rc);
 	}
-	return 2;
+	return rc;
 }
 
 /* zero all fields on new connection */
 void hid_clean_vars(struct ble_gap_conn_desc* desc)
 {
-	// save semaphore for new connection use
-	SemaphoreHandle_t semaphore_saved = My_hid_dev.semaphore;
-	int				  rc			  = -1;
+	taskENTER_CRITICAL(&Flow_lock);
+	/* mbufs of the previous connection may still be on their way to the pool, keep counting them */
+	uint32_t in_flight = My_hid_dev.flow.in_flight;
+	memset(&My_hid_dev, 0, sizeof(struct hid_device_data));
+	My_hid_dev.flow.in_flight = in_flight;
+	taskEXIT_CRITICAL(&Flow_lock);
 
-	if(semaphore_saved)
-	{
-		rc = lock_hid_data();
-	}
+	taskENTER_CRITICAL(&Mouse_pending_lock);
+	memset(&Mouse_pending, 0, sizeof(Mouse_pending));
+	Mouse_report_pending = false;
+	taskEXIT_CRITICAL(&Mouse_pending_lock);
 
-	memset(&My_hid_dev, 0, sizeof(struct hid_device_data));
+	/* a new connection starts in report protocol mode */
+	hid_build_report_tables();
 
-	for(int i = 0; i < sizeof(Notify_data_reports) / sizeof(Notify_data_reports[0]); ++i)
+	/* the mouse report is rewritten by the report task, see hid_on_connection_changed() */
+	for(int i = 0; i < REPORTS_COUNT; ++i)
 	{
 		Notify_data_reports[i].can_indicate = false;
 		Notify_data_reports[i].can_notify	= false;
-		switch(Notify_data_reports[i].handle_num)
-		{
-		case HANDLE_HID_MOUSE_REPORT:
-			memset(Notify_data_reports[i].buffer, 0, Notify_data_reports[i].buffer_size);
-		}
-	}
-
-	if(semaphore_saved)
-	{
-		My_hid_dev.semaphore = semaphore_saved;
-	} else
-	{
-		My_hid_dev.semaphore = xSemaphoreCreateMutex();
-		assert(My_hid_dev.semaphore != NULL);
 	}
 
 	My_hid_dev.conn_handle = desc->conn_handle;
 	My_hid_dev.connected   = true;
 
-	if(!rc)
-	{
-		unlock_hid_data();
-	}
-
 	hid_on_connection_changed();
 }
 
@@ -217,6 +250,10 @@ bool hid_set_report_mode(bool is_mode_boot)
 {
 	bool old_boot				= My_hid_dev.report_mode_boot;
 	My_hid_dev.report_mode_boot = is_mode_boot;
+	if(old_boot != is_mode_boot)
+	{
+		hid_build_report_tables();
+	}
 	return old_boot;
 }
 
@@ -235,29 +272,19 @@ char* print_buf(uint8_t* buf, int buf_size)
 int hid_read_buffer(struct os_mbuf* buf, int handle_num)
 {
 	int rc		= 0;
-	int rep_idx = -1;
-
-	for(int i = 0; i < sizeof(Notify_data_reports) / sizeof(Notify_data_reports[0]); ++i)
-	{
-		if(Notify_data_reports[i].handle_num == handle_num || Notify_data_reports[i].handle_boot_num == handle_num)
-		{
-			rep_idx = i;
-			break;
-		}
-	}
+	int rep_idx = report_slot_by_num(handle_num);
 
-	if(rep_idx != -1 && lock_hid_data() == 0)
+	if(rep_idx != -1)
 	{
-		rc = os_mbuf_append(buf, Notify_data_reports[rep_idx].buffer, Notify_data_reports[rep_idx].buffer_size);
-		unlock_hid_data();
+		uint8_t data[REPORT_BUFFER_MAX];
+		report_buffer_read(Notify_data_reports[rep_idx].buffer, data, Notify_data_reports[rep_idx].buffer_size);
+		rc = os_mbuf_append(buf, data, Notify_data_reports[rep_idx].buffer_size);
 
 		// ESP_LOGI("", "%s read data: %s", __FUNCTION__,
-		//     print_buf(Notify_data_reports[rep_idx].buffer,
-		//         Notify_data_reports[rep_idx].buffer_size));
+		//     print_buf(data, Notify_data_reports[rep_idx].buffer_size));
 	} else
 	{
-		if(rep_idx == -1)
-			ESP_LOGW(tag, "%s: handle_num %d not found", __FUNCTION__, handle_num);
+		ESP_LOGW(tag, "%s: handle_num %d not found", __FUNCTION__, handle_num);
 		return 2;
 	}
 
@@ -267,34 +294,24 @@ int hid_read_buffer(struct os_mbuf* buf, int handle_num)
 int hid_write_buffer(struct os_mbuf* buf, int handle_num)
 {
 	int rc		= 0;
+	int rep_idx = report_slot_by_num(handle_num);
 
-	int rep_idx = -1;
-
-	for(int i = 0; i < sizeof(Notify_data_reports) / sizeof(Notify_data_reports[0]); ++i)
-	{
-		if(Notify_data_reports[i].handle_num == handle_num || Notify_data_reports[i].handle_boot_num == handle_num)
-		{
-			rep_idx = i;
-			break;
-		}
-	}
-	if(rep_idx != -1 && lock_hid_data() == 0)
+	if(rep_idx != -1)
 	{
+		uint8_t data[REPORT_BUFFER_MAX];
 		if(OS_MBUF_PKTLEN(buf) == Notify_data_reports[rep_idx].buffer_size)
 		{
-			rc = ble_hs_mbuf_to_flat(buf, Notify_data_reports[rep_idx].buffer, OS_MBUF_PKTLEN(buf), NULL);
+			rc = ble_hs_mbuf_to_flat(buf, data, OS_MBUF_PKTLEN(buf), NULL);
 		} else
 		{
 			rc = 4;
 		}
-		unlock_hid_data();
 		if(rc == 0)
 		{
-			/* Feature report mapping is Notify_data_reports index 2 in this implementation. */
-			int feature_idx = 2; /* index of feature in Notify_data_reports */
-			if(rep_idx == feature_idx)
+			report_buffer_write(Notify_data_reports[rep_idx].buffer, data, Notify_data_reports[rep_idx].buffer_size);
+			if(rep_idx == report_slot_by_num(HANDLE_HID_FEATURE_REPORT))
 			{
-				resolution_multiplier = Notify_data_reports[rep_idx].buffer[0];
+				resolution_multiplier = data[0];
 				ESP_LOGI(tag, "%s: Feature report written, resolution_multiplier=%u", __FUNCTION__, resolution_multiplier);
 			}
 		}
@@ -310,83 +327,202 @@ int hid_write_buffer(struct os_mbuf* buf, int handle_num)
 	0 - using ble_gattc_indicate_custom     using custom buffer
 	1 - using ble_gattc_indicate            to only one connection
 	2 - using ble_gatts_chr_updated         to all connected centrals
+	3 - using ble_gattc_indicate_custom     with the report built in a mbuf of Hid_mbuf_pool
 */
 #define SEND_METHOD_CUSTOM 0
 #define SEND_METHOD_STD	   1
 #define SEND_METHOD_ALL	   2
+#define SEND_METHOD_POOL   3
 
-#define NOTIFY_METHOD	   SEND_METHOD_STD
+#define NOTIFY_METHOD	   SEND_METHOD_POOL
 
-/* send report data to central using notify/indicate */
-int hid_send_report(int report_handle_num)
+/* mbuf from the transmit pool with the report copied in place, NULL if the pool is empty */
+static struct os_mbuf* hid_mbuf_get_report(struct report_buffer* buffer, size_t size)
 {
-	/* check semaphore, connection and suspend state */
-	if(!My_hid_dev.semaphore || !My_hid_dev.connected || My_hid_dev.suspended_state)
+	struct os_mbuf* om = os_mbuf_get_pkthdr(&Hid_mbuf_pool, 0);
+	if(!om)
 	{
-		ESP_LOGI(tag, "%s semaphore %p %d %d", __FUNCTION__, My_hid_dev.semaphore, My_hid_dev.connected,
-				 My_hid_dev.suspended_state);
-		return 1;
+		return NULL;
 	}
+	om->om_data += HID_MBUF_LEADING_SPACE;
+	report_buffer_read(buffer, om->om_data, size);
+	om->om_len					  = size;
+	OS_MBUF_PKTHDR(om)->omp_len = size;
+	return om;
+}
 
-	int report_idx = -1;
+/* take a notification credit, false if all are in flight */
+static bool flow_take_credit()
+{
+	bool ok = false;
+	taskENTER_CRITICAL(&Flow_lock);
+	struct hid_flow_stats* flow = &My_hid_dev.flow;
+	if(flow->in_flight < HID_NOTIFY_CREDITS)
+	{
+		flow->in_flight++;
+		if(flow->in_flight > flow->in_flight_max)
+			flow->in_flight_max = flow->in_flight;
+		ok = true;
+	} else
+	{
+		My_hid_dev.flow_waiting = true;
+	}
+	taskEXIT_CRITICAL(&Flow_lock);
+	return ok;
+}
+
+/* return a credit, the report left the host or was never handed to it,
+true if a report is waiting for it */
+static bool flow_return_credit()
+{
+	taskENTER_CRITICAL(&Flow_lock);
+	if(My_hid_dev.flow.in_flight > 0)
+		My_hid_dev.flow.in_flight--;
+	bool waiting			= My_hid_dev.flow_waiting;
+	My_hid_dev.flow_waiting = false;
+	taskEXIT_CRITICAL(&Flow_lock);
+	return waiting;
+}
 
-	for(int i = 0; i < sizeof(Notify_data_reports) / sizeof(Notify_data_reports[0]); ++i)
+/* a transmit block is freed: the controller took the packet, the send failed or the connection is gone.
+NOTIFY_TX is raised synchronously while the packet may still wait for a controller buffer, so this is
+where the credit of a pool report comes back. Each mbuf is a single block with the packet header. */
+static os_error_t hid_mbuf_put(struct os_mempool_ext* mpe, void* data, void* arg)
+{
+	os_error_t rc = os_memblock_put_from_cb(&mpe->mpe_mp, data);
+	/* a failed send also lands here, it is retried by the report task with a backoff, not at once */
+	if(flow_return_credit() && hid_mouse_has_pending())
 	{
-		if(report_handle_num == Notify_data_reports[i].handle_num)
-		{
-			report_idx = i;
-			break;
-		}
+		hid_on_notify_ready();
 	}
+	return rc;
+}
 
-	if(report_idx == -1)
+/* BLE_GAP_EVENT_NOTIFY_TX: the notification was handed to the host, failed or an indication was confirmed.
+The stack raises it for failed sends too, so the errors are only counted here. */
+void hid_notify_tx(uint16_t conn_handle, uint16_t attr_handle, int status, bool indication)
+{
+	if(!My_hid_dev.connected || conn_handle != My_hid_dev.conn_handle)
+		return;
+
+	if(status != 0 && status != BLE_HS_EDONE)
 	{
-		ESP_LOGW(tag, "%s: Unknown report_handle_num %d", __FUNCTION__, report_handle_num);
-		return 2;
+		taskENTER_CRITICAL(&Flow_lock);
+		My_hid_dev.flow.errors++;
+		taskEXIT_CRITICAL(&Flow_lock);
+	} else if(status == 0)
+	{
+		conn_params_report_sent();
+	}
+	/* an indication was confirmed or timed out, a report refused meanwhile can go out */
+	if(indication && status != 0 && hid_mouse_has_pending())
+	{
+		hid_on_notify_ready();
 	}
+}
 
-	uint16_t send_handle;
-	int		 rc = 0;
+void hid_get_flow_stats(struct hid_flow_stats* stats)
+{
+	taskENTER_CRITICAL(&Flow_lock);
+	*stats = My_hid_dev.flow;
+	taskEXIT_CRITICAL(&Flow_lock);
+	stats->mbuf_min_free = Hid_mempool.mpe_mp.mp_min_free;
+}
 
-	if(My_hid_dev.report_mode_boot)
+/* send report data to central using notify/indicate */
+int hid_send_report(int report_handle_num)
+{
+	/* check connection and suspend state */
+	if(!My_hid_dev.connected || My_hid_dev.suspended_state)
 	{
-		send_handle = Svc_char_handles[Notify_data_reports[report_idx].handle_boot_num];
-	} else
+		ESP_LOGI(tag, "%s %d %d", __FUNCTION__, My_hid_dev.connected, My_hid_dev.suspended_state);
+		return 1;
+	}
+
+	int report_idx = report_slot_by_num(report_handle_num);
+	if(report_idx == -1)
 	{
-		send_handle = Svc_char_handles[Notify_data_reports[report_idx].handle_num];
+		ESP_LOGW(tag, "%s: Unknown report_handle_num %d", __FUNCTION__, report_handle_num);
+		return 2;
 	}
 
+	uint16_t send_handle = Notify_data_reports[report_idx].attr_handle;
+	int		 rc			 = 0;
+
 	switch(NOTIFY_METHOD)
 	{
 	case SEND_METHOD_CUSTOM:
 		{
-			if(lock_hid_data() == 0)
+			if(!Notify_data_reports[report_idx].can_indicate && !Notify_data_reports[report_idx].can_notify)
 			{
-				struct os_mbuf* om = ble_hs_mbuf_from_flat(Notify_data_reports[report_idx].buffer,
-														   Notify_data_reports[report_idx].buffer_size);
-				unlock_hid_data();
-
-				if(Notify_data_reports[report_idx].can_indicate)
-				{
-					rc = ble_gattc_indicate_custom(My_hid_dev.conn_handle, send_handle, om);
-				} else if(Notify_data_reports[report_idx].can_notify)
-				{
-					rc = ble_gattc_notify_custom(My_hid_dev.conn_handle, send_handle, om);
-				}
+				return 3;
+			}
+			/* msys blocks give no completion signal, the reports are sent without credits */
+			uint8_t data[REPORT_BUFFER_MAX];
+			report_buffer_read(Notify_data_reports[report_idx].buffer, data, Notify_data_reports[report_idx].buffer_size);
+			struct os_mbuf* om = ble_hs_mbuf_from_flat(data, Notify_data_reports[report_idx].buffer_size);
+
+			if(Notify_data_reports[report_idx].can_indicate)
+			{
+				rc = ble_gattc_indicate_custom(My_hid_dev.conn_handle, send_handle, om);
+			} else
+			{
+				rc = ble_gattc_notify_custom(My_hid_dev.conn_handle, send_handle, om);
 			}
 			break;
 		}
 
 	case SEND_METHOD_STD:
+		if(!Notify_data_reports[report_idx].can_indicate && !Notify_data_reports[report_idx].can_notify)
+		{
+			/* central is not subscribed */
+			return 3;
+		}
 		if(Notify_data_reports[report_idx].can_indicate)
 		{
 			rc = ble_gattc_indicate(My_hid_dev.conn_handle, send_handle);
-		} else if(Notify_data_reports[report_idx].can_notify)
+		} else
 		{
 			rc = ble_gattc_notify(My_hid_dev.conn_handle, send_handle);
 		}
 		break;
 
+	case SEND_METHOD_POOL:
+		{
+			if(!Notify_data_reports[report_idx].can_indicate && !Notify_data_reports[report_idx].can_notify)
+			{
+				return 3;
+			}
+			if(!flow_take_credit())
+			{
+				return HID_SEND_BUSY;
+			}
+			struct os_mbuf* om =
+				hid_mbuf_get_report(Notify_data_reports[report_idx].buffer, Notify_data_reports[report_idx].buffer_size);
+			if(!om)
+			{
+				/* no block was taken, hid_mbuf_put() will not return this credit but it wakes the waiting report
+				when the blocks of other reports come back */
+				flow_return_credit();
+				taskENTER_CRITICAL(&Flow_lock);
+				My_hid_dev.flow.mbuf_exhausted++;
+				My_hid_dev.flow_waiting = true;
+				taskEXIT_CRITICAL(&Flow_lock);
+				return HID_SEND_BUSY;
+			}
+
+			/* the stack owns om from here, it is freed to the pool on success and on failure,
+			hid_mbuf_put() returns the credit either way */
+			if(Notify_data_reports[report_idx].can_indicate)
+			{
+				rc = ble_gattc_indicate_custom(My_hid_dev.conn_handle, send_handle, om);
+			} else
+			{
+				rc = ble_gattc_notify_custom(My_hid_dev.conn_handle, send_handle, om);
+			}
+			break;
+		}
+
 	case SEND_METHOD_ALL:
 		ble_gatts_chr_updated(send_handle);
 		rc = 0;
@@ -397,59 +533,87 @@ int hid_send_report(int report_handle_num)
 		ESP_LOGE(tag, "%s: Notify error in function", __FUNCTION__);
 	}
 
-	return 0;
+	return rc;
 }
 
 uint8_t hid_battery_level_get(void)
 {
-	return Battery_level[0];
+	uint8_t level;
+	report_buffer_read(&Battery_level, &level, HIDD_LE_BATTERY_LEVEL_SIZE);
+	return level;
 }
 
 int hid_battery_level_set(uint8_t level)
 {
-	int rc = 0;
-
-	if(lock_hid_data() == 0)
-	{
-		if(Battery_level[0] != level)
-		{
-			Battery_level[0] = level;
-		}
-		unlock_hid_data();
-
-		rc = hid_send_report(HANDLE_BATTERY_LEVEL);
-	} else
-	{
-		return -2;
-	}
+	report_buffer_write(&Battery_level, &level, HIDD_LE_BATTERY_LEVEL_SIZE);
+	return hid_send_report(HANDLE_BATTERY_LEVEL);
+}
 
-	return rc;
+int hid_telemetry_set(const uint8_t* data)
+{
+	report_buffer_write(&Telemetry_buffer, data, HIDD_LE_TELEMETRY_SIZE);
+	return hid_send_report(HANDLE_TELEMETRY_SURFACE);
 }
 
-int hid_mouse_send_report(uint8_t mouse_button, int16_t mickeys_x, int16_t mickeys_y, int16_t wheel, int16_t ac_pan)
+int hid_mouse_send_report(uint8_t mouse_button, int32_t mickeys_x, int32_t mickeys_y, int32_t wheel, int32_t ac_pan)
 {
 	if(!hid_get_connected())
 		return 1;
 
-	if(lock_hid_data() == 0)
+	/* Send the new motion together with anything which was not delivered before */
+	int16_t x, y, w, p;
+	taskENTER_CRITICAL(&Mouse_pending_lock);
+	motion_accum_add(&Mouse_pending, mickeys_x, mickeys_y, wheel, ac_pan);
+	motion_accum_take(&Mouse_pending, &x, &y, &w, &p);
+	taskEXIT_CRITICAL(&Mouse_pending_lock);
+
+	uint8_t report[HIDD_LE_REPORT_MOUSE_SIZE];
+	report[0]	  = mouse_button;				 // Buttons
+	report[1]	  = (uint8_t) (x & 0xFF);		 // X Low
+	report[2]	  = (uint8_t) ((x >> 8) & 0xFF); // X High
+	report[3]	  = (uint8_t) (y & 0xFF);		 // Y Low
+	report[4]	  = (uint8_t) ((y >> 8) & 0xFF); // Y High
+
+	/* High-resolution vertical wheel (16-bit signed, little-endian) */
+	report[5] = (uint8_t)(w & 0xFF);         // Wheel Low
+	report[6] = (uint8_t)((w >> 8) & 0xFF);  // Wheel High
+	/* High-resolution horizontal (AC Pan) (16-bit signed, little-endian) */
+	report[7] = (uint8_t)(p & 0xFF);        // AC Pan Low
+	report[8] = (uint8_t)((p >> 8) & 0xFF); // AC Pan High
+
+	/* published without waiting, the host reads it when the notification is built */
+	report_buffer_write(&Mouse_buffer, report, HIDD_LE_REPORT_MOUSE_SIZE);
+
+	int rc = hid_send_report(HANDLE_HID_MOUSE_REPORT);
+
+	/* Not delivered, carry it to the next report. Without a credit the newest motion
+	is merged into the pending report, it is sent when a notification completes.
+	A report without motion stays pending too, it may carry a button change. */
+	taskENTER_CRITICAL(&Mouse_pending_lock);
+	Mouse_report_pending = rc != 0;
+	if(rc != 0)
 	{
-		Mouse_buffer[0]	  = mouse_button;						 // Buttons
-		Mouse_buffer[1]	  = (uint8_t) (mickeys_x & 0xFF);		 // X Low
-		Mouse_buffer[2]	  = (uint8_t) ((mickeys_x >> 8) & 0xFF); // X High
-		Mouse_buffer[3]	  = (uint8_t) (mickeys_y & 0xFF);		 // Y Low
-		Mouse_buffer[4]	  = (uint8_t) ((mickeys_y >> 8) & 0xFF); // Y High
-
-		/* High-resolution vertical wheel (16-bit signed, little-endian) */
-		Mouse_buffer[5] = (uint8_t)(wheel & 0xFF);         // Wheel Low
-		Mouse_buffer[6] = (uint8_t)((wheel >> 8) & 0xFF);  // Wheel High
-		/* High-resolution horizontal (AC Pan) (16-bit signed, little-endian) */
-		Mouse_buffer[7] = (uint8_t)(ac_pan & 0xFF);        // AC Pan Low
-		Mouse_buffer[8] = (uint8_t)((ac_pan >> 8) & 0xFF); // AC Pan High
-
-		unlock_hid_data();
-
-		return hid_send_report(HANDLE_HID_MOUSE_REPORT);
+		motion_accum_add(&Mouse_pending, x, y, w, p);
 	}
+	taskEXIT_CRITICAL(&Mouse_pending_lock);
 
-	return 1;
+	if(rc != 0)
+	{
+		if(rc == HID_SEND_BUSY)
+		{
+			taskENTER_CRITICAL(&Flow_lock);
+			My_hid_dev.flow.coalesced++;
+			taskEXIT_CRITICAL(&Flow_lock);
+		}
+	}
+
+	return rc;
+}
+
+bool hid_mouse_has_pending(void)
+{
+	taskENTER_CRITICAL(&Mouse_pending_lock);
+	bool pending = Mouse_report_pending || !motion_accum_empty(&Mouse_pending);
+	taskEXIT_CRITICAL(&Mouse_pending_lock);
+	return pending && hid_get_connected();
 }
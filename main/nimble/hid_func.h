@@ -4,24 +4,51 @@
 
 #include "host/ble_gap.h"
 
+// surface telemetry data size, see hid_telemetry_set()
+#define HIDD_LE_TELEMETRY_SIZE (10)
+
+// reports of the transmit pool which may wait in the host for a controller buffer at once
+#define HID_NOTIFY_CREDITS (3)
+// hid_send_report() result when all credits are in use, the report is not sent
+#define HID_SEND_BUSY (5)
+// mbufs of the report transmit pool, they stay in use until the controller took the packet
+#define HID_MBUF_COUNT (8)
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+	struct hid_flow_stats
+	{
+		uint32_t in_flight;		// Pool reports the controller did not take yet
+		uint32_t in_flight_max; // Highest in_flight since the connection was established
+		uint32_t coalesced;		// Mouse reports merged into the pending report because no credit was left
+		uint32_t errors;		// Notifications the stack refused or failed to send
+		uint32_t mbuf_exhausted; // Reports not sent because the transmit pool was empty
+		uint32_t mbuf_min_free;	 // Lowest number of free transmit mbufs since boot
+	};
+
+	int	 hid_init(void);
 	void hid_clean_vars(struct ble_gap_conn_desc* desc);
 	void hid_set_disconnected();
 	bool hid_get_connected();
 	bool hid_get_rssi(int8_t* out_rssi);
 	void hid_set_notify(uint16_t attr_handle, uint8_t cur_notify, uint8_t cur_indicate);
+	void hid_build_report_tables(void);
 	bool hid_set_suspend(bool need_suspend);
 	bool hid_set_report_mode(bool boot_mode);
 	void hid_on_connection_changed(); // this function must be externaly implemented
+	void hid_on_notify_ready();		  // this function must be externaly implemented, mouse motion can be sent again
+	void hid_notify_tx(uint16_t conn_handle, uint16_t attr_handle, int status, bool indication);
+	void hid_get_flow_stats(struct hid_flow_stats* stats);
 
 	uint8_t hid_battery_level_get(void);
 
 	int hid_battery_level_set(uint8_t level);
-	int hid_mouse_send_report(uint8_t mouse_button, int16_t mickeys_x, int16_t mickeys_y, int16_t wheel, int16_t ac_pan);
+	int hid_telemetry_set(const uint8_t* data); // HIDD_LE_TELEMETRY_SIZE bytes
+	int hid_mouse_send_report(uint8_t mouse_button, int32_t mickeys_x, int32_t mickeys_y, int32_t wheel, int32_t ac_pan);
+	bool hid_mouse_has_pending(void); // a report or motion which was not delivered yet, see hid_mouse_send_report()
 
 	int hid_write_buffer(struct os_mbuf* buf, int handle_num);
 
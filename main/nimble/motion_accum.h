@@ -0,0 +1,66 @@
+#ifndef H_MOTION_ACCUM_
+#define H_MOTION_ACCUM_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Motion which was not delivered to the host yet. Deltas are accumulated in 32 bits,
+each report takes at most what fits into the 16 bit report fields and the remainder
+stays for the next report. Deltas of a report which failed to send are given back. */
+struct motion_accum
+{
+	int32_t dx;
+	int32_t dy;
+	int32_t wheel;
+	int32_t ac_pan;
+};
+
+/* Keep the sum far from the 32 bit limits, it can grow while the host does not accept reports */
+#define MOTION_ACCUM_LIMIT (INT32_MAX / 2)
+
+static inline int32_t motion_accum_add_sat(int32_t acc, int32_t value)
+{
+	int64_t sum = (int64_t) acc + value;
+	if(sum > MOTION_ACCUM_LIMIT)
+		return MOTION_ACCUM_LIMIT;
+	if(sum < -MOTION_ACCUM_LIMIT)
+		return -MOTION_ACCUM_LIMIT;
+	return (int32_t) sum;
+}
+
+static inline int16_t motion_accum_take_axis(int32_t* acc)
+{
+	int32_t take = *acc;
+	if(take > INT16_MAX)
+		take = INT16_MAX;
+	/* -32768 is avoided, some hosts treat it as invalid */
+	if(take < -INT16_MAX)
+		take = -INT16_MAX;
+	*acc -= take;
+	return (int16_t) take;
+}
+
+static inline void motion_accum_add(struct motion_accum* acc, int32_t dx, int32_t dy, int32_t wheel, int32_t ac_pan)
+{
+	acc->dx		= motion_accum_add_sat(acc->dx, dx);
+	acc->dy		= motion_accum_add_sat(acc->dy, dy);
+	acc->wheel	= motion_accum_add_sat(acc->wheel, wheel);
+	acc->ac_pan = motion_accum_add_sat(acc->ac_pan, ac_pan);
+}
+
+/* Move the part which fits into one report from acc to out */
+static inline void motion_accum_take(struct motion_accum* acc, int16_t* dx, int16_t* dy, int16_t* wheel,
+									 int16_t* ac_pan)
+{
+	*dx		= motion_accum_take_axis(&acc->dx);
+	*dy		= motion_accum_take_axis(&acc->dy);
+	*wheel	= motion_accum_take_axis(&acc->wheel);
+	*ac_pan = motion_accum_take_axis(&acc->ac_pan);
+}
+
+static inline bool motion_accum_empty(const struct motion_accum* acc)
+{
+	return acc->dx == 0 && acc->dy == 0 && acc->wheel == 0 && acc->ac_pan == 0;
+}
+
+#endif
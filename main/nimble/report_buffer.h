@@ -0,0 +1,66 @@
+#ifndef H_REPORT_BUFFER_
+#define H_REPORT_BUFFER_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* largest report kept in a report_buffer */
+#define REPORT_BUFFER_MAX 16
+
+/* Report data shared by the writer tasks and the NimBLE host.
+A writer fills the copy which is not current and publishes it by incrementing seq.
+Writers are serialized by a short critical section around the copy of the report,
+so a report written from another task is never mixed into the one being published.
+Readers take no lock, they copy the current report and retry if a new one was
+published meanwhile, so they never wait for a preempted writer. */
+struct report_buffer
+{
+	uint32_t	 seq;  // publications, data[seq & 1] is the current report
+	portMUX_TYPE lock; // held by a writer, must be initialized with REPORT_BUFFER_INIT
+	uint8_t		 data[2][REPORT_BUFFER_MAX];
+};
+
+/* initializer of a report_buffer, the initial report bytes may follow */
+#define REPORT_BUFFER_INIT(...) {.seq = 0, .lock = portMUX_INITIALIZER_UNLOCKED, .data = {{__VA_ARGS__}}}
+
+static inline void report_buffer_write(struct report_buffer* rb, const uint8_t* src, size_t size)
+{
+	taskENTER_CRITICAL(&rb->lock);
+	uint32_t seq = __atomic_load_n(&rb->seq, __ATOMIC_RELAXED);
+	uint8_t* dst = rb->data[(seq + 1) & 1];
+
+	/* readers of this copy must see the previous publication before any of the new bytes */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	for(size_t i = 0; i < size; ++i)
+	{
+		__atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&rb->seq, seq + 1, __ATOMIC_RELEASE);
+	taskEXIT_CRITICAL(&rb->lock);
+}
+
+/* copy the current report, returns the number of torn reads which were retried */
+static inline uint32_t report_buffer_read(struct report_buffer* rb, uint8_t* dst, size_t size)
+{
+	uint32_t retries = 0;
+	for(;;)
+	{
+		uint32_t	   seq = __atomic_load_n(&rb->seq, __ATOMIC_ACQUIRE);
+		const uint8_t* src = rb->data[seq & 1];
+		for(size_t i = 0; i < size; ++i)
+		{
+			dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+		}
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if(__atomic_load_n(&rb->seq, __ATOMIC_RELAXED) == seq)
+		{
+			return retries;
+		}
+		retries++;
+	}
+}
+
+#endif
@@ -292,3 +292,29 @@ void ssd1306_show(ssd1306_t *p) {
 
     fancy_write(p->i2c_i, p->buffer-1, p->bufsize+1);
 }
+
+void ssd1306_show_pages(ssd1306_t *p, uint8_t first_page, uint8_t last_page) {
+    if(last_page>=p->pages)
+        last_page=p->pages-1;
+    if(first_page>last_page)
+        return;
+
+    uint8_t payload[]= {SET_COL_ADDR, 0, p->width-1, SET_PAGE_ADDR, first_page, last_page};
+    if(p->width==64) {
+        payload[1]+=32;
+        payload[2]+=32;
+    }
+
+    for(size_t i=0; i<sizeof(payload); ++i)
+        ssd1306_write(p, payload[i]);
+
+    // The data control byte goes right before the first page, keep the pixels it overwrites
+    uint8_t *start=p->buffer+(size_t)first_page*p->width;
+    uint8_t saved=*(start-1);
+    *(start-1)=0x40;
+
+    fancy_write(p->i2c_i, start-1, (size_t)(last_page-first_page+1)*p->width+1);
+
+    if(first_page>0)
+        *(start-1)=saved;
+}
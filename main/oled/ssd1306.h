@@ -140,6 +140,16 @@ extern "C"
 	*/
 	void ssd1306_show(ssd1306_t* p);
 
+	/**
+		@brief display part of the buffer, for small changes
+
+		@param[in] p : instance of display
+		@param[in] first_page : first page (8 pixel rows) to send
+		@param[in] last_page : last page to send, inclusive
+
+	*/
+	void ssd1306_show_pages(ssd1306_t* p, uint8_t first_page, uint8_t last_page);
+
 	/**
 		@brief clear display buffer
 
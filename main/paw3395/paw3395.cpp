@@ -1,8 +1,14 @@
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 #include <esp_private/esp_clk.h>
+#include <cstring>
+#include <algorithm>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
 #include "paw3395.h"
+#include "paw3395_tables.h"
 
 // Timing constants
 const uint8_t PAW3395_TIMINGS_SRAD			= 2; // 2μs
@@ -20,8 +26,10 @@ const uint8_t PAW3395_REG_DELTA_X_L			= 0x03;
 const uint8_t PAW3395_REG_DELTA_X_H			= 0x04;
 const uint8_t PAW3395_REG_DELTA_Y_L			= 0x05;
 const uint8_t PAW3395_REG_DELTA_Y_H			= 0x06;
+const uint8_t PAW3395_REG_FRAME_CAPTURE		= 0x12;
 const uint8_t PAW3395_REG_MOTION_BURST		= 0x16;
 const uint8_t PAW3395_REG_POWERUPRESET		= 0x3A;
+const uint8_t PAW3395_REG_SHUTDOWN			= 0x3B;
 const uint8_t PAW3395_REG_SET_RESOLUTION	= 0x47;
 const uint8_t PAW3395_REG_RESOLUTION_X_LOW	= 0x48;
 const uint8_t PAW3395_REG_RESOLUTION_X_HIGH = 0x49;
@@ -29,25 +37,59 @@ const uint8_t PAW3395_REG_RESOLUTION_Y_LOW	= 0x4A;
 const uint8_t PAW3395_REG_RESOLUTION_Y_HIGH = 0x4B;
 const uint8_t PAW3395_REG_RIPPLE_CONTROL	= 0x5A;
 const uint8_t PAW3395_REG_MOTION_CTRL		= 0x5C;
+const uint8_t PAW3395_REG_RAW_DATA_BURST	= 0x64;
+const uint8_t PAW3395_REG_PERFORMANCE		= 0x40;
+const uint8_t PAW3395_REG_RUN_DOWNSHIFT		= 0x77;
+const uint8_t PAW3395_REG_REST1_PERIOD		= 0x78;
+const uint8_t PAW3395_REG_REST1_DOWNSHIFT	= 0x79;
+const uint8_t PAW3395_REG_REST2_PERIOD		= 0x7A;
+const uint8_t PAW3395_REG_REST2_DOWNSHIFT	= 0x7B;
+const uint8_t PAW3395_REG_REST3_PERIOD		= 0x7C;
+const uint8_t PAW3395_REG_BANK_SELECT		= 0x7F;
+
+// Sampling stops after no motion for this time
+const uint32_t PAW3395_IDLE_TIMEOUT_US		= 10000;
+
+// Rest mode register units: Run downshift in 10 ms steps, rest period is (value + 1) ms,
+// rest downshift in steps of 32 frame periods
+const uint32_t PAW3395_RUN_DOWNSHIFT_UNIT_MS = 10;
+const uint32_t PAW3395_REST_DOWNSHIFT_FRAMES = 32;
 
 // Register values
 const uint8_t PAW3395_POWERUPRESET_POWERON	= 0x5A;
 
 // Register bits
+const uint8_t PAW3395_MOTION_MOT			= 0x80;
+const uint8_t PAW3395_MOTION_CTRL_RES_Y		= 0x08; // Y resolution is set by RESOLUTION_Y, otherwise it follows X
 const uint8_t PAW3395_OP_MODE0				= 0;
 const uint8_t PAW3395_OP_MODE1				= 1;
+const uint8_t PAW3395_OP_MODE_MASK			= 0x03;
 const uint8_t PAW3395_PG_FIRST				= 6;
 const uint8_t PAW3395_PG_VALID				= 7;
 
+paw3395::~paw3395()
+{
+	if(m_sample_timer)
+	{
+		esp_timer_stop(m_sample_timer);
+		esp_timer_delete(m_sample_timer);
+	}
+	heap_caps_free(m_burst_tx);
+	heap_caps_free(m_burst_rx);
+	heap_caps_free(m_batch_buf);
+}
+
 esp_err_t paw3395::init(spi_host_device_t host_id, gpio_num_t ncs_pin, gpio_num_t pin_motion, uint16_t dpi,
-						const OnMotionCallback_t& on_motion)
+						const OnMotionCallback_t& on_motion, const OnIdleCallback_t& on_idle)
 {
 	m_pin_ncs			 = ncs_pin;
 	m_pin_motion		 = pin_motion;
 	m_on_motion_callback = on_motion;
+	m_on_idle_callback	 = on_idle;
 
 	m_motion_semaphore	 = xSemaphoreCreateBinary();
-	if(!m_motion_semaphore)
+	m_bus_mutex			 = xSemaphoreCreateRecursiveMutex();
+	if(!m_motion_semaphore || !m_bus_mutex)
 	{
 		ESP_LOGE(m_log_tag, "Failed to create semaphore");
 		return ESP_FAIL;
@@ -79,20 +121,46 @@ esp_err_t paw3395::init(spi_host_device_t host_id, gpio_num_t ncs_pin, gpio_num_
 		return ret;
 	}
 
+	// Motion burst is read with one DMA transfer, so the buffers must be DMA capable
+	m_burst_tx = static_cast<uint8_t*>(heap_caps_calloc(1, sizeof(motion_burst_data), MALLOC_CAP_DMA));
+	m_burst_rx = static_cast<uint8_t*>(heap_caps_calloc(1, sizeof(motion_burst_data), MALLOC_CAP_DMA));
+	if(!m_burst_tx || !m_burst_rx)
+	{
+		ESP_LOGE(m_log_tag, "Failed to allocate motion burst buffers");
+		return ESP_ERR_NO_MEM;
+	}
+
+	// Write descriptors are prepared once and only the payload changes
+	m_batch_buf = static_cast<uint8_t*>(heap_caps_calloc(BATCH_SIZE, 2, MALLOC_CAP_DMA));
+	if(!m_batch_buf)
+	{
+		ESP_LOGE(m_log_tag, "Failed to allocate register batch buffer");
+		return ESP_ERR_NO_MEM;
+	}
+	for(size_t i = 0; i < BATCH_SIZE; i++)
+	{
+		m_batch[i].length	 = 16;
+		m_batch[i].tx_buffer = m_batch_buf + i * 2;
+	}
+
 	cs_high();
+	int64_t start		= esp_timer_get_time();
 	Power_up_sequence();
-	set_dpi(dpi);
+	m_spi_stats.init_us = (uint32_t) (esp_timer_get_time() - start);
+	ESP_LOGI(m_log_tag, "Power up sequence: %lu us, %lu SPI transactions", m_spi_stats.init_us,
+			 m_spi_stats.transactions);
+	m_cpi_x = m_cpi_y = dpi;
 
 	uint8_t product_id = read_register(0);
 	printf("PAW3395 Product ID: 0x%02X\n", product_id);
 
-	// Enable RIPPLE CONTROL
-	write_register(PAW3395_REG_RIPPLE_CONTROL, 0x80);
-	// office_mode();
-	// gaming_mode();
+	apply_settings();
+	m_idle_since = esp_timer_get_time();
 
-	// Lift cut 2mm
-	set_lift_cut(2);
+#ifdef CONFIG_TRACKBALL_SENSOR_BENCHMARK
+	benchmark_read_motion(1000);
+	benchmark_register_writes(10);
+#endif
 
 	if(xTaskCreate((TaskFunction_t) motion_task, "paw3395_motion", 4096, this, 5, &m_motion_task) != pdPASS)
 	{
@@ -100,22 +168,55 @@ esp_err_t paw3395::init(spi_host_device_t host_id, gpio_num_t ncs_pin, gpio_num_
 		return ESP_FAIL;
 	}
 
+	esp_timer_create_args_t timer_args = {};
+	timer_args.callback				   = [](void* arg) { xTaskNotifyGive(static_cast<TaskHandle_t>(arg)); };
+	timer_args.arg					   = m_motion_task;
+	timer_args.name					   = "paw3395_sample";
+	ret								   = esp_timer_create(&timer_args, &m_sample_timer);
+	if(ret != ESP_OK)
+	{
+		ESP_LOGE(m_log_tag, "Failed to create sampling timer: %d", ret);
+		return ret;
+	}
+
 	init_motion_pin();
 	return ESP_OK;
 }
 
+void paw3395::apply_settings()
+{
+	bus_lock lock(m_bus_mutex);
+	set_dpi(m_cpi_x, m_cpi_y);
+
+	// Enable RIPPLE CONTROL
+	write_register(PAW3395_REG_RIPPLE_CONTROL, 0x80);
+
+	set_lift_cut(m_lift_height);
+
+	// Applies the rest mode configuration too
+	if(set_mode(m_mode) != ESP_OK)
+	{
+		ESP_LOGW(m_log_tag, "Sensor mode was not verified");
+	}
+}
+
 void paw3395::set_lift_cut(uint8_t lift_height)
 {
-	write_register(0x7F, 0xC0);
+	bus_lock lock(m_bus_mutex);
+	m_lift_height = lift_height;
+	begin_batch();
+	write_register(PAW3395_REG_BANK_SELECT, 0xC0);
 	write_register(0x4E, lift_height);
-	write_register(0x7F, 0x00);
+	write_register(PAW3395_REG_BANK_SELECT, 0x00);
+	end_batch();
 }
 
-static void IRAM_ATTR motion_isr_handler(void* arg)
+void IRAM_ATTR paw3395::motion_isr_handler(void* arg)
 {
 	BaseType_t woken = pdFALSE;
-	auto	   sem	 = static_cast<SemaphoreHandle_t>(arg);
-	xSemaphoreGiveFromISR(sem, &woken);
+	auto	   pThis = static_cast<paw3395*>(arg);
+	pThis->m_wake_at = esp_timer_get_time();
+	xSemaphoreGiveFromISR(pThis->m_motion_semaphore, &woken);
 	portYIELD_FROM_ISR(woken);
 }
 
@@ -130,7 +231,7 @@ void paw3395::init_motion_pin()
 	};
 	gpio_config(&io_conf);
 
-	gpio_isr_handler_add(m_pin_motion, motion_isr_handler, m_motion_semaphore);
+	gpio_isr_handler_add(m_pin_motion, motion_isr_handler, this);
 }
 
 void paw3395::motion_task(void* param)
@@ -138,27 +239,359 @@ void paw3395::motion_task(void* param)
 	auto pThis = static_cast<paw3395*>(param);
 	while(true)
 	{
+		// The sampling timer runs only while the ball moves, otherwise wait for the motion pin
 		if(xSemaphoreTake(pThis->m_motion_semaphore, portMAX_DELAY))
 		{
-			int16_t dx		= 0;
-			int16_t dy		= 0;
-			int		counter = 0;
-			while(counter < 5)
+			pThis->sample_motion();
+		}
+	}
+}
+
+void paw3395::sample_motion()
+{
+	uint32_t	period_us  = m_sample_period_us;
+	uint32_t	idle_ticks = 0;
+	motion_data data	   = {};
+
+	on_wake();
+	esp_timer_start_periodic(m_sample_timer, period_us);
+	while(true)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		// The sensor accumulates deltas between the ticks, so one read returns all motion since the last one
+		bool moved = read_motion(&data);
+		update_sampler_stats(esp_timer_get_time(), moved, period_us);
+		if(moved)
+		{
+			idle_ticks = 0;
+			if(m_wake_state != POWER_STATE_COUNT)
 			{
-				if(pThis->read_motion(&dx, &dy))
-				{
-					if(pThis->m_on_motion_callback)
-					{
-						pThis->m_on_motion_callback(dx, dy);
-					}
-				} else
+				uint32_t latency = (uint32_t) (esp_timer_get_time() - m_wake_edge_at);
+				portENTER_CRITICAL(&m_stats_lock);
+				m_power_stats.wake_latency_us[m_wake_state] = latency;
+				m_power_stats.wake_latency_max_us[m_wake_state] =
+					std::max(m_power_stats.wake_latency_max_us[m_wake_state], latency);
+				portEXIT_CRITICAL(&m_stats_lock);
+				m_wake_state = POWER_STATE_COUNT;
+			}
+			if(m_on_motion_callback)
+			{
+				m_on_motion_callback(data);
+			}
+		} else if(++idle_ticks >= PAW3395_IDLE_TIMEOUT_US / period_us)
+		{
+			esp_timer_stop(m_sample_timer);
+			publish_sampler_stats(esp_timer_get_time());
+			// Drop the edge which was latched while sampling, unless the motion pin is still asserted
+			xSemaphoreTake(m_motion_semaphore, 0);
+			if(gpio_get_level(m_pin_motion) != 0)
+			{
+				on_idle();
+				if(m_on_idle_callback)
 				{
-					counter++;
-					vTaskDelay(pdMS_TO_TICKS(1));
+					m_on_idle_callback();
 				}
+				return;
 			}
+			idle_ticks = 0;
+			esp_timer_start_periodic(m_sample_timer, period_us);
+		}
+
+		if(period_us != m_sample_period_us)
+		{
+			period_us = m_sample_period_us;
+			esp_timer_stop(m_sample_timer);
+			esp_timer_start_periodic(m_sample_timer, period_us);
+		}
+	}
+}
+
+esp_err_t paw3395::set_poll_rate(uint16_t rate_hz)
+{
+	if(rate_hz != 125 && rate_hz != 250 && rate_hz != 500 && rate_hz != 1000)
+	{
+		ESP_LOGE(m_log_tag, "Unsupported poll rate: %d Hz", rate_hz);
+		return ESP_ERR_INVALID_ARG;
+	}
+	// Picked up by the motion task on the next tick
+	m_sample_period_us = 1000000 / rate_hz;
+	return ESP_OK;
+}
+
+void paw3395::update_sampler_stats(int64_t now, bool moved, uint32_t period_us)
+{
+	if(m_window.start == 0)
+	{
+		m_window.start		  = now;
+		m_window.interval_min = UINT32_MAX;
+	}
+	m_window.samples++;
+	if(moved)
+	{
+		m_window.reports++;
+		uint32_t interval = (uint32_t) (now - m_window.last_report);
+		// Gaps without motion are not jitter
+		if(m_window.last_report != 0 && interval < period_us * 2)
+		{
+			m_window.intervals++;
+			m_window.interval_min = std::min(m_window.interval_min, interval);
+			m_window.interval_max = std::max(m_window.interval_max, interval);
+			m_window.deviation_sum += interval > period_us ? interval - period_us : period_us - interval;
 		}
+		m_window.last_report = now;
+	}
+	if(now - m_window.start >= 1000000)
+	{
+		publish_sampler_stats(now);
+	}
+}
+
+void paw3395::publish_sampler_stats(int64_t now)
+{
+	int64_t elapsed = now - m_window.start;
+	if(m_window.start == 0 || elapsed <= 0)
+	{
+		return;
 	}
+
+	sampler_stats stats	  = {};
+	stats.reports_per_sec = (uint32_t) (m_window.reports * 1000000LL / elapsed);
+	stats.samples_per_sec = (uint32_t) (m_window.samples * 1000000LL / elapsed);
+	if(m_window.intervals)
+	{
+		stats.interval_min_us = m_window.interval_min;
+		stats.interval_max_us = m_window.interval_max;
+		stats.jitter_us		  = (uint32_t) (m_window.deviation_sum / m_window.intervals);
+	}
+
+	portENTER_CRITICAL(&m_stats_lock);
+	m_sampler_stats = stats;
+	portEXIT_CRITICAL(&m_stats_lock);
+
+	m_window = {};
+}
+
+void paw3395::on_wake()
+{
+	int64_t now = esp_timer_get_time();
+	int64_t at	= m_wake_at;
+	if(at < m_idle_since || at > now)
+	{
+		at = now;
+	}
+	portENTER_CRITICAL(&m_stats_lock);
+	power_stats stats = {};
+	account_idle(stats, at - m_idle_since);
+	for(int i = 0; i < POWER_STATE_COUNT; i++)
+	{
+		m_power_time_us[i] += stats.time_ms[i] * 1000LL;
+	}
+	m_wake_state = power_state_at(at - m_idle_since);
+	m_power_stats.wakes[m_wake_state]++;
+	m_run_since	 = at;
+	m_idle_since = 0;
+	portEXIT_CRITICAL(&m_stats_lock);
+
+	m_wake_edge_at = at;
+}
+
+void paw3395::on_idle()
+{
+	int64_t now = esp_timer_get_time();
+	portENTER_CRITICAL(&m_stats_lock);
+	m_power_time_us[POWER_RUN] += now - m_run_since;
+	m_idle_since = now;
+	portEXIT_CRITICAL(&m_stats_lock);
+	// A wake up without motion does not count for the latency
+	m_wake_state = POWER_STATE_COUNT;
+}
+
+paw3395::power_state_t paw3395::power_state_at(int64_t idle_us) const
+{
+	int64_t until = m_power_times.run_downshift_ms * 1000LL;
+	if(idle_us < until)
+	{
+		return POWER_RUN;
+	}
+	until += m_power_times.rest1_downshift_ms * 1000LL;
+	if(idle_us < until)
+	{
+		return POWER_REST1;
+	}
+	until += m_power_times.rest2_downshift_ms * 1000LL;
+	if(idle_us < until)
+	{
+		return POWER_REST2;
+	}
+	return POWER_REST3;
+}
+
+void paw3395::account_idle(power_stats& stats, int64_t idle_us) const
+{
+	// Split the idle time between the states the sensor went through
+	const int64_t limits[] = {
+		m_power_times.run_downshift_ms,
+		m_power_times.rest1_downshift_ms,
+		m_power_times.rest2_downshift_ms,
+		INT64_MAX / 1000,
+	};
+	int64_t idle_ms = idle_us / 1000;
+	for(int i = 0; i < POWER_STATE_COUNT && idle_ms > 0; i++)
+	{
+		int64_t t = std::min(idle_ms, limits[i]);
+		stats.time_ms[i] += (uint32_t) t;
+		idle_ms -= t;
+	}
+}
+
+paw3395::power_state_t paw3395::get_power_state()
+{
+	portENTER_CRITICAL(&m_stats_lock);
+	int64_t idle_since = m_idle_since;
+	portEXIT_CRITICAL(&m_stats_lock);
+	if(idle_since == 0)
+	{
+		return POWER_RUN;
+	}
+	return power_state_at(esp_timer_get_time() - idle_since);
+}
+
+paw3395::power_stats paw3395::get_power_stats()
+{
+	int64_t now = esp_timer_get_time();
+	portENTER_CRITICAL(&m_stats_lock);
+	power_stats stats = m_power_stats;
+	int64_t		time_us[POWER_STATE_COUNT];
+	memcpy(time_us, m_power_time_us, sizeof(time_us));
+	int64_t idle_since = m_idle_since;
+	int64_t run_since  = m_run_since;
+	portEXIT_CRITICAL(&m_stats_lock);
+
+	// Include the current period
+	memset(stats.time_ms, 0, sizeof(stats.time_ms));
+	if(idle_since != 0)
+	{
+		account_idle(stats, now - idle_since);
+	} else
+	{
+		time_us[POWER_RUN] += now - run_since;
+	}
+	for(int i = 0; i < POWER_STATE_COUNT; i++)
+	{
+		stats.time_ms[i] += (uint32_t) (time_us[i] / 1000);
+	}
+	return stats;
+}
+
+const char* paw3395::power_state_name(power_state_t state)
+{
+	switch(state)
+	{
+	case POWER_RUN:
+		return "run";
+	case POWER_REST1:
+		return "rest1";
+	case POWER_REST2:
+		return "rest2";
+	case POWER_REST3:
+		return "rest3";
+	default:
+		return "unknown";
+	}
+}
+
+esp_err_t paw3395::set_power_config(const power_config& config)
+{
+	bus_lock lock(m_bus_mutex);
+	m_power_config = config;
+	return apply_power_config();
+}
+
+esp_err_t paw3395::apply_power_config()
+{
+	const power_config& c = m_power_config;
+
+	// Times left at 0 keep the values of the initialization and the sensor mode
+	const uint8_t addresses[] = {
+		PAW3395_REG_RUN_DOWNSHIFT, PAW3395_REG_REST1_PERIOD,	PAW3395_REG_REST1_DOWNSHIFT,
+		PAW3395_REG_REST2_PERIOD,  PAW3395_REG_REST2_DOWNSHIFT, PAW3395_REG_REST3_PERIOD,
+	};
+	const uint32_t requested[] = {
+		c.run_downshift_ms, c.rest1_period_ms,	  c.rest1_downshift_ms,
+		c.rest2_period_ms,	c.rest2_downshift_ms, c.rest3_period_ms,
+	};
+	uint8_t values[6];
+	write_register(PAW3395_REG_BANK_SELECT, 0x00);
+	for(int i = 0; i < 6; i++)
+	{
+		values[i] = read_register(addresses[i]);
+	}
+
+	paw3395_reg regs[6];
+	size_t		count = 0;
+	for(int i = 0; i < 6; i++)
+	{
+		if(requested[i] == 0)
+		{
+			continue;
+		}
+		if(i == 0)
+		{
+			values[i] = (uint8_t) std::clamp<uint32_t>(requested[i] / PAW3395_RUN_DOWNSHIFT_UNIT_MS, 1, 255);
+		} else if(i % 2)
+		{
+			// Rest period, the register holds the period - 1
+			values[i] = (uint8_t) (std::clamp<uint32_t>(requested[i], 1, 256) - 1);
+		} else
+		{
+			// Rest downshift, counted in frames of the period preceding it
+			uint32_t frame_ms = (values[i - 1] + 1) * PAW3395_REST_DOWNSHIFT_FRAMES;
+			values[i]		  = (uint8_t) std::clamp<uint32_t>(requested[i] / frame_ms, 1, 255);
+		}
+		regs[count++] = {0x00, addresses[i], values[i]};
+	}
+
+	// The state is tracked with the times the registers represent
+	power_config& t		 = m_power_times;
+	t.run_downshift_ms	 = values[0] * PAW3395_RUN_DOWNSHIFT_UNIT_MS;
+	t.rest1_period_ms	 = values[1] + 1;
+	t.rest1_downshift_ms = values[2] * t.rest1_period_ms * PAW3395_REST_DOWNSHIFT_FRAMES;
+	t.rest2_period_ms	 = values[3] + 1;
+	t.rest2_downshift_ms = values[4] * t.rest2_period_ms * PAW3395_REST_DOWNSHIFT_FRAMES;
+	t.rest3_period_ms	 = values[5] + 1;
+
+	if(count == 0)
+	{
+		return ESP_OK;
+	}
+	paw3395_reg_table table = {regs, count};
+	write_table(table);
+	return verify_table(table);
+}
+
+esp_err_t paw3395::verify_table(const paw3395_reg_table& table)
+{
+	esp_err_t ret = ESP_OK;
+	for(size_t i = 0; i < table.count; i++)
+	{
+		const paw3395_reg& r = table.regs[i];
+		write_register(PAW3395_REG_BANK_SELECT, r.bank);
+		uint8_t value = read_register(r.reg);
+		if(value != r.value)
+		{
+			ESP_LOGE(m_log_tag, "Register 0x%02X:0x%02X reads 0x%02X, expected 0x%02X", r.bank, r.reg, value,
+					 r.value);
+			ret = ESP_ERR_INVALID_RESPONSE;
+		}
+	}
+	write_register(PAW3395_REG_BANK_SELECT, 0x00);
+	if(ret != ESP_OK)
+	{
+		// The shadow copy can not be trusted anymore
+		invalidate_shadow();
+	}
+	return ret;
 }
 
 void paw3395::delay_125_ns(uint8_t nns)
@@ -183,11 +616,33 @@ uint8_t paw3395::SPI_SendReceive(uint8_t data)
 	{
 		printf("SPI transaction failed: %d\n", ret);
 	}
+	m_spi_stats.transactions++;
+	m_spi_stats.bytes++;
 	return data;
 }
 
+void paw3395::SPI_Transfer(const uint8_t* tx, uint8_t* rx, size_t len)
+{
+	spi_transaction_t t = {};
+	t.length			= len * 8;
+	t.tx_buffer			= tx;
+	t.rxlength			= len * 8;
+	t.rx_buffer			= rx;
+
+	esp_err_t ret		= spi_device_polling_transmit(m_spi, &t);
+	if(ret != ESP_OK)
+	{
+		printf("SPI transaction failed: %d\n", ret);
+	}
+	m_spi_stats.transactions++;
+	m_spi_stats.bytes += len;
+}
+
 uint8_t paw3395::read_register(uint8_t address, bool apply_cs)
 {
+	select_bank();
+	flush_batch();
+	wait_bus_idle();
 	if(apply_cs)
 		cs_low();
 	delay_125_ns(1);
@@ -196,11 +651,113 @@ uint8_t paw3395::read_register(uint8_t address, bool apply_cs)
 	uint8_t temp = SPI_SendReceive(0xFF);
 	if(apply_cs)
 		cs_high();
-	// delay_us(5); // t_SWW
+	bus_busy_for(PAW3395_TIMINGS_SRWSRR);
 	return temp;
 }
 
-void paw3395::write_register(uint8_t address, uint8_t value)
+bool paw3395::write_register(uint8_t address, uint8_t value)
+{
+	if(address == PAW3395_REG_BANK_SELECT)
+	{
+		// The bank select is written only when a register of the bank is accessed
+		m_bank_selected = value;
+		m_reg_stats.bank_requests++;
+		return false;
+	}
+
+	m_reg_stats.write_requests++;
+	if(is_cacheable(address))
+	{
+		uint8_t&  shadow = m_shadow[m_bank_selected][address];
+		uint32_t& valid	 = m_shadow_valid[m_bank_selected][address / 32];
+		uint32_t  bit	 = 1UL << (address % 32);
+		if((valid & bit) && shadow == value)
+		{
+			return false;
+		}
+		shadow = value;
+		valid |= bit;
+	}
+
+	select_bank();
+	queue_write(address, value);
+	m_reg_stats.writes++;
+	if(address == PAW3395_REG_POWERUPRESET)
+	{
+		// All registers return to the defaults, the bank is selected again before the next access
+		invalidate_shadow();
+		m_bank			= 0xFF;
+		m_bank_selected = 0;
+	}
+	return true;
+}
+
+void paw3395::queue_write(uint8_t address, uint8_t value)
+{
+	if(m_legacy_io)
+	{
+		write_register_bytewise(address, value);
+		return;
+	}
+	if(m_batch_count == BATCH_SIZE)
+	{
+		flush_batch();
+	}
+	m_batch_buf[m_batch_count * 2]	   = address | PAW3395_SPI_WRITE;
+	m_batch_buf[m_batch_count * 2 + 1] = value;
+	m_batch_count++;
+	if(m_batch_depth == 0)
+	{
+		flush_batch();
+	}
+}
+
+void paw3395::select_bank()
+{
+	if(m_bank != m_bank_selected)
+	{
+		m_bank = m_bank_selected;
+		queue_write(PAW3395_REG_BANK_SELECT, m_bank);
+		m_reg_stats.bank_switches++;
+	}
+}
+
+bool paw3395::is_cacheable(uint8_t address) const
+{
+	if(m_bank_selected >= SHADOW_BANKS || address >= 0x80)
+	{
+		return false;
+	}
+	if(m_bank_selected == 0)
+	{
+		// Data and command registers must always be accessed
+		switch(address)
+		{
+		case PAW3395_REG_MOTION:
+		case PAW3395_REG_DELTA_X_L:
+		case PAW3395_REG_DELTA_X_H:
+		case PAW3395_REG_DELTA_Y_L:
+		case PAW3395_REG_DELTA_Y_H:
+		case PAW3395_REG_FRAME_CAPTURE:
+		case PAW3395_REG_MOTION_BURST:
+		case PAW3395_REG_RAW_DATA_BURST:
+		case PAW3395_REG_POWERUPRESET:
+		case PAW3395_REG_SHUTDOWN:
+		case PAW3395_REG_SET_RESOLUTION:
+			return false;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+void paw3395::invalidate_shadow()
+{
+	memset(m_shadow_valid, 0, sizeof(m_shadow_valid));
+}
+
+void paw3395::write_register_bytewise(uint8_t address, uint8_t value)
 {
 	cs_low();
 	delay_125_ns(1);
@@ -210,6 +767,45 @@ void paw3395::write_register(uint8_t address, uint8_t value)
 	delay_us(5); // t_SWW
 }
 
+void paw3395::flush_batch()
+{
+	if(m_batch_count == 0)
+	{
+		return;
+	}
+
+	// Keep the bus for the whole batch, so the driver does not lock it for every write
+	spi_device_acquire_bus(m_spi, portMAX_DELAY);
+	for(size_t i = 0; i < m_batch_count; i++)
+	{
+		// t_SWW is counted from the end of the previous write, so the descriptor setup overlaps the gap
+		wait_bus_idle();
+		cs_low();
+		delay_125_ns(PAW3395_TIMINGS_NCS_SCLK);
+		esp_err_t ret = spi_device_polling_transmit(m_spi, &m_batch[i]);
+		cs_high();
+		bus_busy_for(PAW3395_TIMINGS_SWW);
+		if(ret != ESP_OK)
+		{
+			printf("SPI transaction failed: %d\n", ret);
+			// The lost write may have been a bank select
+			m_bank = 0xFF;
+		}
+	}
+	spi_device_release_bus(m_spi);
+
+	m_spi_stats.transactions += m_batch_count;
+	m_spi_stats.bytes += m_batch_count * 2;
+	m_spi_stats.batched_writes += m_batch_count;
+	m_batch_count = 0;
+}
+
+void paw3395::wait_bus_idle()
+{
+	while(esp_timer_get_time() < m_bus_idle_at)
+		;
+}
+
 void paw3395::Power_up_sequence()
 {
 	uint8_t reg_it;
@@ -221,6 +817,9 @@ void paw3395::Power_up_sequence()
 	cs_low();
 	delay_125_ns(PAW3395_TIMINGS_NCS_SCLK);
 
+	// The sensor may be left in any bank by a previous run, the reset register is in bank 0
+	m_bank = 0xFF;
+	write_register(PAW3395_REG_BANK_SELECT, 0x00);
 	write_register(PAW3395_REG_POWERUPRESET, PAW3395_POWERUPRESET_POWERON);
 	delay_ms(5);
 	Power_Up_Initializaton_Register_Setting();
@@ -236,13 +835,81 @@ void paw3395::Power_up_sequence()
 	delay_125_ns(PAW3395_TIMINGS_BEXIT);
 }
 
-bool paw3395::read_motion(int16_t* dx, int16_t* dy)
+bool paw3395::read_motion(motion_data* data)
+{
+	motion_burst_data burst;
+	motion_burst(&burst);
+
+	if((burst.motion & PAW3395_MOTION_MOT) != 0)
+	{
+		data->dx = (int16_t) (burst.delta_x_l | (burst.delta_x_h << 8));
+		data->dy = (int16_t) (burst.delta_y_l | (burst.delta_y_h << 8));
+	} else
+	{
+		data->dx = 0;
+		data->dy = 0;
+	}
+	data->squal		   = burst.squal;
+	data->raw_data_sum = burst.raw_data_sum;
+	data->shutter	   = (uint16_t) ((burst.shutter_upper << 8) | burst.shutter_lower);
+	return data->dx != 0 || data->dy != 0;
+}
+
+esp_err_t paw3395::frame_grab(uint8_t* frame)
+{
+	// Dummy bytes clocked out while the frame is read, both buffers are used by DMA
+	uint8_t* tx = static_cast<uint8_t*>(heap_caps_calloc(1, FRAME_SIZE, MALLOC_CAP_DMA));
+	uint8_t* rx = static_cast<uint8_t*>(heap_caps_malloc(FRAME_SIZE, MALLOC_CAP_DMA));
+	if(!tx || !rx)
+	{
+		heap_caps_free(tx);
+		heap_caps_free(rx);
+		ESP_LOGE(m_log_tag, "Failed to allocate frame buffers");
+		return ESP_ERR_NO_MEM;
+	}
+
+	// The motion task blocks on the bus lock and the motion pin is ignored until the sensor is configured again
+	bus_lock lock(m_bus_mutex);
+	gpio_intr_disable(m_pin_motion);
+
+	begin_batch();
+	write_register(PAW3395_REG_BANK_SELECT, 0x00);
+	write_register(PAW3395_REG_FRAME_CAPTURE, 0x83);
+	write_register(PAW3395_REG_FRAME_CAPTURE, 0xC5);
+	end_batch();
+	delay_ms(20);
+
+	// Address byte and then the whole frame in one transfer under the same CS assertion
+	select_bank();
+	wait_bus_idle();
+	cs_low();
+	delay_125_ns(PAW3395_TIMINGS_NCS_SCLK);
+	SPI_SendReceive(PAW3395_REG_RAW_DATA_BURST);
+	delay_us(PAW3395_TIMINGS_SRAD);
+	SPI_Transfer(tx, rx, FRAME_SIZE);
+	cs_high();
+	delay_125_ns(PAW3395_TIMINGS_BEXIT);
+	memcpy(frame, rx, FRAME_SIZE);
+	heap_caps_free(tx);
+	heap_caps_free(rx);
+
+	// The sensor leaves the frame capture mode by a reset only
+	Power_up_sequence();
+	apply_settings();
+
+	// Drop the edges latched before the capture, the deltas were cleared by the reset
+	xSemaphoreTake(m_motion_semaphore, 0);
+	gpio_intr_enable(m_pin_motion);
+	return ESP_OK;
+}
+
+bool paw3395::read_motion_registers(int16_t* dx, int16_t* dy)
 {
 	uint8_t motion, x_l, x_h, y_l, y_h;
 
 	// Read the Motion register. This will freeze the Delta_X and Delta_Y registers until they are read.
 	motion = read_register(PAW3395_REG_MOTION);
-	if((motion & 0x80) != 0)
+	if((motion & PAW3395_MOTION_MOT) != 0)
 	{
 		cs_low();
 		x_l = read_register(PAW3395_REG_DELTA_X_L, false);
@@ -262,164 +929,80 @@ bool paw3395::read_motion(int16_t* dx, int16_t* dy)
 
 void paw3395::motion_burst(motion_burst_data* values)
 {
-	uint8_t* buffer = reinterpret_cast<uint8_t*>(values);
+	// Address byte, t_SRAD and then all burst bytes in one transfer under the same CS assertion
+	bus_lock lock(m_bus_mutex);
+	select_bank();
+	flush_batch();
+	wait_bus_idle();
 	cs_low();
 	delay_125_ns(PAW3395_TIMINGS_NCS_SCLK);
 	SPI_SendReceive(PAW3395_REG_MOTION_BURST);
 	delay_us(PAW3395_TIMINGS_SRAD);
-	for(uint8_t i = 0; i < 12; i++)
-	{
-		buffer[i] = SPI_SendReceive(0x00);
-	}
+	SPI_Transfer(m_burst_tx, m_burst_rx, sizeof(motion_burst_data));
 	cs_high();
+	memcpy(values, m_burst_rx, sizeof(motion_burst_data));
 	delay_125_ns(PAW3395_TIMINGS_BEXIT);
 }
 
+void paw3395::benchmark_register_writes(uint32_t iterations)
+{
+	int64_t times[2] = {};
+	for(int legacy = 1; legacy >= 0; legacy--)
+	{
+		m_legacy_io	  = legacy != 0;
+		int64_t start = esp_timer_get_time();
+		for(uint32_t i = 0; i < iterations; i++)
+		{
+			// Measure the writes themselves, not the shadow copy
+			invalidate_shadow();
+			set_mode(0);
+		}
+		times[legacy] = esp_timer_get_time() - start;
+	}
+	m_legacy_io = false;
+
+	ESP_LOGI(m_log_tag, "Mode switch byte by byte: %.1f us, batched: %.1f us", (float) times[1] / iterations,
+			 (float) times[0] / iterations);
+
+	int64_t start = esp_timer_get_time();
+	set_mode(0);
+	ESP_LOGI(m_log_tag, "Mode switch with unchanged registers: %lld us", esp_timer_get_time() - start);
+}
+
+void paw3395::benchmark_read_motion(uint32_t samples)
+{
+	int16_t		dx, dy;
+	motion_data data;
+
+	uint32_t trans = m_spi_stats.transactions;
+	int64_t	 start = esp_timer_get_time();
+	for(uint32_t i = 0; i < samples; i++)
+	{
+		read_motion_registers(&dx, &dy);
+	}
+	int64_t	 reg_us	   = esp_timer_get_time() - start;
+	uint32_t reg_trans = m_spi_stats.transactions - trans;
+
+	trans = m_spi_stats.transactions;
+	start = esp_timer_get_time();
+	for(uint32_t i = 0; i < samples; i++)
+	{
+		read_motion(&data);
+	}
+	int64_t	 burst_us	 = esp_timer_get_time() - start;
+	uint32_t burst_trans = m_spi_stats.transactions - trans;
+
+	ESP_LOGI(m_log_tag, "Motion read by registers: %.2f transactions, %.2f us per sample",
+			 (float) reg_trans / samples, (float) reg_us / samples);
+	ESP_LOGI(m_log_tag, "Motion read by burst: %.2f transactions, %.2f us per sample",
+			 (float) burst_trans / samples, (float) burst_us / samples);
+}
+
 void paw3395::Power_Up_Initializaton_Register_Setting()
 {
 	uint8_t read_tmp;
 	uint8_t i;
-	write_register(0x7F, 0x07);
-	write_register(0x40, 0x41);
-	write_register(0x7F, 0x00);
-	write_register(0x40, 0x80);
-	write_register(0x7F, 0x0E);
-	write_register(0x55, 0x0D);
-	write_register(0x56, 0x1B);
-	write_register(0x57, 0xE8);
-	write_register(0x58, 0xD5);
-	write_register(0x7F, 0x14);
-	write_register(0x42, 0xBC);
-	write_register(0x43, 0x74);
-	write_register(0x4B, 0x20);
-	write_register(0x4D, 0x00);
-	write_register(0x53, 0x0E);
-	write_register(0x7F, 0x05);
-	write_register(0x44, 0x04);
-	write_register(0x4D, 0x06);
-	write_register(0x51, 0x40);
-	write_register(0x53, 0x40);
-	write_register(0x55, 0xCA);
-	write_register(0x5A, 0xE8);
-	write_register(0x5B, 0xEA);
-	write_register(0x61, 0x31);
-	write_register(0x62, 0x64);
-	write_register(0x6D, 0xB8);
-	write_register(0x6E, 0x0F);
-
-	write_register(0x70, 0x02);
-	write_register(0x4A, 0x2A);
-	write_register(0x60, 0x26);
-	write_register(0x7F, 0x06);
-	write_register(0x6D, 0x70);
-	write_register(0x6E, 0x60);
-	write_register(0x6F, 0x04);
-	write_register(0x53, 0x02);
-	write_register(0x55, 0x11);
-	write_register(0x7A, 0x01);
-	write_register(0x7D, 0x51);
-	write_register(0x7F, 0x07);
-	write_register(0x41, 0x10);
-	write_register(0x42, 0x32);
-	write_register(0x43, 0x00);
-	write_register(0x7F, 0x08);
-	write_register(0x71, 0x4F);
-	write_register(0x7F, 0x09);
-	write_register(0x62, 0x1F);
-	write_register(0x63, 0x1F);
-	write_register(0x65, 0x03);
-	write_register(0x66, 0x03);
-	write_register(0x67, 0x1F);
-	write_register(0x68, 0x1F);
-	write_register(0x69, 0x03);
-	write_register(0x6A, 0x03);
-	write_register(0x6C, 0x1F);
-
-	write_register(0x6D, 0x1F);
-	write_register(0x51, 0x04);
-	write_register(0x53, 0x20);
-	write_register(0x54, 0x20);
-	write_register(0x71, 0x0C);
-	write_register(0x72, 0x07);
-	write_register(0x73, 0x07);
-	write_register(0x7F, 0x0A);
-	write_register(0x4A, 0x14);
-	write_register(0x4C, 0x14);
-	write_register(0x55, 0x19);
-	write_register(0x7F, 0x14);
-	write_register(0x4B, 0x30);
-	write_register(0x4C, 0x03);
-	write_register(0x61, 0x0B);
-	write_register(0x62, 0x0A);
-	write_register(0x63, 0x02);
-	write_register(0x7F, 0x15);
-	write_register(0x4C, 0x02);
-	write_register(0x56, 0x02);
-	write_register(0x41, 0x91);
-	write_register(0x4D, 0x0A);
-	write_register(0x7F, 0x0C);
-	write_register(0x4A, 0x10);
-	write_register(0x4B, 0x0C);
-	write_register(0x4C, 0x40);
-	write_register(0x41, 0x25);
-	write_register(0x55, 0x18);
-	write_register(0x56, 0x14);
-	write_register(0x49, 0x0A);
-	write_register(0x42, 0x00);
-	write_register(0x43, 0x2D);
-	write_register(0x44, 0x0C);
-	write_register(0x54, 0x1A);
-	write_register(0x5A, 0x0D);
-	write_register(0x5F, 0x1E);
-	write_register(0x5B, 0x05);
-	write_register(0x5E, 0x0F);
-	write_register(0x7F, 0x0D);
-	write_register(0x48, 0xDD);
-	write_register(0x4F, 0x03);
-	write_register(0x52, 0x49);
-
-	write_register(0x51, 0x00);
-	write_register(0x54, 0x5B);
-	write_register(0x53, 0x00);
-
-	write_register(0x56, 0x64);
-	write_register(0x55, 0x00);
-	write_register(0x58, 0xA5);
-	write_register(0x57, 0x02);
-	write_register(0x5A, 0x29);
-	write_register(0x5B, 0x47);
-	write_register(0x5C, 0x81);
-	write_register(0x5D, 0x40);
-	write_register(0x71, 0xDC);
-	write_register(0x70, 0x07);
-	write_register(0x73, 0x00);
-	write_register(0x72, 0x08);
-	write_register(0x75, 0xDC);
-	write_register(0x74, 0x07);
-	write_register(0x77, 0x00);
-	write_register(0x76, 0x08);
-	write_register(0x7F, 0x10);
-	write_register(0x4C, 0xD0);
-	write_register(0x7F, 0x00);
-	write_register(0x4F, 0x63);
-	write_register(0x4E, 0x00);
-	write_register(0x52, 0x63);
-	write_register(0x51, 0x00);
-	write_register(0x54, 0x54);
-	write_register(0x5A, 0x10);
-	write_register(0x77, 0x4F);
-	write_register(0x47, 0x01);
-	write_register(0x5B, 0x40);
-	write_register(0x64, 0x60);
-	write_register(0x65, 0x06);
-	write_register(0x66, 0x13);
-	write_register(0x67, 0x0F);
-	write_register(0x78, 0x01);
-	write_register(0x79, 0x9C);
-	write_register(0x40, 0x00);
-	write_register(0x55, 0x02);
-	write_register(0x23, 0x70);
-	write_register(0x22, 0x01);
+	write_table(paw3395_make_table(PAW3395_INIT_REGS));
 
 	delay_ms(1);
 
@@ -432,133 +1015,75 @@ void paw3395::Power_Up_Initializaton_Register_Setting()
 	}
 	if(i == 60)
 	{
-		write_register(0x7F, 0x14);
-		write_register(0x6C, 0x00);
-		write_register(0x7F, 0x00);
+		write_table(paw3395_make_table(PAW3395_INIT_FALLBACK_REGS));
 	}
-	write_register(0x22, 0x00);
-	write_register(0x55, 0x00);
-	write_register(0x7F, 0x07);
-	write_register(0x40, 0x40);
-	write_register(0x7F, 0x00);
+	write_table(paw3395_make_table(PAW3395_INIT_FINISH_REGS));
 }
 
-void paw3395::set_dpi(uint16_t CPI_Num)
+void paw3395::set_dpi(uint16_t cpi_x, uint16_t cpi_y)
 {
-	uint8_t temp;
-	cs_low();
-	delay_125_ns(PAW3395_TIMINGS_NCS_SCLK);
-	write_register(PAW3395_REG_MOTION_CTRL, 0x00);
-	temp = (uint8_t) (((CPI_Num / 50) << 8) >> 8);
-	write_register(PAW3395_REG_RESOLUTION_X_LOW, temp);
-	temp = (uint8_t) ((CPI_Num / 50) >> 8);
-	write_register(PAW3395_REG_RESOLUTION_X_HIGH, temp);
-	write_register(PAW3395_REG_SET_RESOLUTION, 0x01);
-	cs_high();
-	delay_125_ns(PAW3395_TIMINGS_BEXIT);
+	uint16_t res_x = cpi_x / 50;
+	uint16_t res_y = cpi_y / 50;
+
+	bus_lock lock(m_bus_mutex);
+	m_cpi_x = cpi_x;
+	m_cpi_y = cpi_y;
+	begin_batch();
+	bool changed;
+	if(res_x == res_y)
+	{
+		changed = write_register(PAW3395_REG_MOTION_CTRL, 0x00);
+	} else
+	{
+		changed = write_register(PAW3395_REG_MOTION_CTRL, PAW3395_MOTION_CTRL_RES_Y);
+		changed |= write_register(PAW3395_REG_RESOLUTION_Y_LOW, (uint8_t) (res_y & 0xFF));
+		changed |= write_register(PAW3395_REG_RESOLUTION_Y_HIGH, (uint8_t) (res_y >> 8));
+	}
+	changed |= write_register(PAW3395_REG_RESOLUTION_X_LOW, (uint8_t) (res_x & 0xFF));
+	changed |= write_register(PAW3395_REG_RESOLUTION_X_HIGH, (uint8_t) (res_x >> 8));
+	if(changed)
+	{
+		write_register(PAW3395_REG_SET_RESOLUTION, 0x01);
+	}
+	end_batch();
+}
+
+esp_err_t paw3395::set_mode(uint8_t mode)
+{
+	if(mode >= sizeof(PAW3395_MODES) / sizeof(PAW3395_MODES[0]))
+	{
+		ESP_LOGE(m_log_tag, "Unknown sensor mode: %d", mode);
+		return ESP_ERR_INVALID_ARG;
+	}
+	bus_lock lock(m_bus_mutex);
+	int64_t	 start = esp_timer_get_time();
+	m_mode		   = mode;
+	write_table(PAW3395_MODES[mode]);
+
+	// The tables set the mode parameters, the operation mode bits select the mode
+	uint8_t	  perf = read_register(PAW3395_REG_PERFORMANCE);
+	esp_err_t ret  = ESP_OK;
+	write_register(PAW3395_REG_PERFORMANCE, (perf & ~PAW3395_OP_MODE_MASK) | mode);
+	if((read_register(PAW3395_REG_PERFORMANCE) & PAW3395_OP_MODE_MASK) != mode)
+	{
+		ESP_LOGE(m_log_tag, "Sensor mode %d was not applied", mode);
+		invalidate_shadow();
+		ret = ESP_ERR_INVALID_RESPONSE;
+	}
+
+	// The mode tables set the Rest1 times, only the explicitly configured times override them
+	esp_err_t power_ret = apply_power_config();
+	if(ret == ESP_OK)
+	{
+		ret = power_ret;
+	}
+	m_spi_stats.mode_switch_us = (uint32_t) (esp_timer_get_time() - start);
+	return ret;
 }
 
-void paw3395::office_mode()
-{
-	write_register(0x7F, 0x05);
-	write_register(0x51, 0x28);
-	write_register(0x53, 0x30);
-	write_register(0x61, 0x3B);
-	write_register(0x6E, 0x1F);
-	write_register(0x7F, 0x07);
-	write_register(0x42, 0x32);
-	write_register(0x43, 0x00);
-	write_register(0x7F, 0x0D);
-	write_register(0x51, 0x00);
-	write_register(0x52, 0x49);
-	write_register(0x53, 0x00);
-	write_register(0x54, 0x5B);
-	write_register(0x55, 0x00);
-	write_register(0x56, 0x64);
-	write_register(0x57, 0x02);
-	write_register(0x58, 0xA5);
-	write_register(0x7F, 0x00);
-	write_register(0x54, 0x52);
-	write_register(0x78, 0x0A);
-	write_register(0x79, 0x0F);
-	uint8_t tmp = read_register(0x40);
-	tmp			= (tmp & 0xFC) | 0x02;
-}
-
-void paw3395::gaming_mode()
-{
-	write_register(0x7F, 0x05);
-	write_register(0x51, 0x40);
-	write_register(0x53, 0x40);
-	write_register(0x61, 0x31);
-	write_register(0x6E, 0x0F);
-	write_register(0x7F, 0x07);
-	write_register(0x42, 0x2F);
-	write_register(0x43, 0x00);
-	write_register(0x7F, 0x0D);
-	write_register(0x51, 0x12);
-	write_register(0x52, 0xDB);
-	write_register(0x53, 0x12);
-	write_register(0x54, 0xDC);
-	write_register(0x55, 0x12);
-	write_register(0x56, 0xEA);
-	write_register(0x57, 0x15);
-	write_register(0x58, 0x2D);
-	write_register(0x7F, 0x00);
-	write_register(0x54, 0x55);
-	write_register(0x40, 0x83);
-}
-
-void paw3395::low_power_mode()
-{
-	write_register(0x7F, 0x05);
-	write_register(0x51, 0x40);
-	write_register(0x53, 0x40);
-	write_register(0x61, 0x3B);
-	write_register(0x6E, 0x1F);
-	write_register(0x7F, 0x07);
-	write_register(0x42, 0x32);
-	write_register(0x43, 0x00);
-	write_register(0x7F, 0x0D);
-	write_register(0x51, 0x00);
-	write_register(0x52, 0x49);
-	write_register(0x53, 0x00);
-	write_register(0x54, 0x5B);
-	write_register(0x55, 0x00);
-	write_register(0x56, 0x64);
-	write_register(0x57, 0x02);
-	write_register(0x58, 0xA5);
-	write_register(0x7F, 0x00);
-	write_register(0x54, 0x54);
-	write_register(0x78, 0x01);
-	write_register(0x79, 0x9C);
-	uint8_t tmp = read_register(0x40);
-	tmp			= (tmp & 0xFC) | 0x02;
-}
-
-void paw3395::high_performance_mode()
-{
-	write_register(0x7F, 0x05);
-	write_register(0x51, 0x40);
-	write_register(0x53, 0x40);
-	write_register(0x61, 0x31);
-	write_register(0x6E, 0x0F);
-	write_register(0x7F, 0x07);
-	write_register(0x42, 0x32);
-	write_register(0x43, 0x00);
-	write_register(0x7F, 0x0D);
-	write_register(0x51, 0x00);
-	write_register(0x52, 0x49);
-	write_register(0x53, 0x00);
-	write_register(0x54, 0x5B);
-	write_register(0x55, 0x00);
-	write_register(0x56, 0x64);
-	write_register(0x57, 0x02);
-	write_register(0x58, 0xA5);
-	write_register(0x7F, 0x00);
-	write_register(0x54, 0x54);
-	write_register(0x78, 0x01);
-	write_register(0x79, 0x9C);
-	uint8_t tmp = read_register(0x40);
-	tmp			= (tmp & 0xFC) | 0x00;
+void paw3395::write_table(const paw3395_reg_table& table)
+{
+	begin_batch();
+	paw3395_write_table(table, [this](uint8_t reg, uint8_t value) { write_register(reg, value); });
+	end_batch();
 }
@@ -7,12 +7,13 @@
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 #include "freertos/semphr.h"
+#include "esp_timer.h"
+
+struct paw3395_reg_table;
 
 class paw3395
 {
 public:
-	using OnMotionCallback_t = std::function<void(int16_t, int16_t)>;
-
 	struct motion_burst_data
 	{
 		uint8_t motion;
@@ -29,6 +30,86 @@ public:
 		uint8_t shutter_lower;
 	} __attribute__((packed));
 
+	struct motion_data
+	{
+		int16_t	 dx;
+		int16_t	 dy;
+		uint8_t	 squal;
+		uint8_t	 raw_data_sum;
+		uint16_t shutter;
+	};
+
+	using OnMotionCallback_t = std::function<void(const motion_data&)>;
+	using OnIdleCallback_t	 = std::function<void()>;
+
+	struct spi_stats
+	{
+		uint32_t transactions;	 // Number of SPI transactions issued
+		uint32_t bytes;			 // Number of bytes clocked over the bus
+		uint32_t batched_writes; // Register writes sent through the batch queue
+		uint32_t init_us;		 // Wall time of the power up sequence
+		uint32_t mode_switch_us; // Wall time of the last sensor mode switch
+	};
+
+	struct sampler_stats
+	{
+		uint32_t reports_per_sec; // Samples with motion during the last second
+		uint32_t samples_per_sec; // Sensor reads during the last second
+		uint32_t interval_min_us; // Shortest time between two consecutive reports
+		uint32_t interval_max_us; // Longest time between two consecutive reports
+		uint32_t jitter_us;		  // Mean deviation of the report interval from the sampling period
+	};
+
+	struct register_stats
+	{
+		uint32_t write_requests; // Register writes requested by the driver
+		uint32_t writes;		 // Register writes sent to the sensor, the rest matched the shadow copy
+		uint32_t bank_requests;	 // Bank selections requested by the driver
+		uint32_t bank_switches;	 // Bank select writes sent to the sensor
+	};
+
+	enum power_state_t : uint8_t
+	{
+		POWER_RUN,
+		POWER_REST1,
+		POWER_REST2,
+		POWER_REST3,
+		POWER_STATE_COUNT,
+	};
+
+	/// Idle times after which the sensor downshifts to the next rest mode and the frame
+	/// periods used in rest modes. A longer period saves power but the sensor notices
+	/// the motion later. A value of 0 keeps what the initialization and the sensor mode
+	/// programmed, e.g. the longer Rest1 period of the office mode.
+	struct power_config
+	{
+		uint16_t run_downshift_ms	= 0; // Run -> Rest1
+		uint16_t rest1_period_ms	= 0;
+		uint32_t rest1_downshift_ms = 0; // Rest1 -> Rest2
+		uint16_t rest2_period_ms	= 0;
+		uint32_t rest2_downshift_ms = 0; // Rest2 -> Rest3
+		uint16_t rest3_period_ms	= 0;
+	};
+
+	struct power_stats
+	{
+		uint32_t time_ms[POWER_STATE_COUNT];			 // Time spent in each state
+		uint32_t wakes[POWER_STATE_COUNT];				 // Wake ups by the motion pin from each state
+		uint32_t wake_latency_us[POWER_STATE_COUNT];	 // Motion pin to the first report, last wake up
+		uint32_t wake_latency_max_us[POWER_STATE_COUNT]; // Motion pin to the first report, worst case
+	};
+
+	// Banks kept in the shadow register file
+	static constexpr size_t SHADOW_BANKS = 0x16;
+
+	// Raw frame dimensions, see frame_grab()
+	static constexpr size_t FRAME_WIDTH	 = 36;
+	static constexpr size_t FRAME_HEIGHT = 36;
+	static constexpr size_t FRAME_SIZE	 = FRAME_WIDTH * FRAME_HEIGHT;
+
+	// Register writes queued before the batch is flushed to the bus
+	static constexpr size_t BATCH_SIZE = 32;
+
 private:
 	const char*			m_log_tag			 = "PAW3395";
 	spi_device_handle_t m_spi				 = nullptr;
@@ -37,25 +118,141 @@ private:
 	SemaphoreHandle_t	m_motion_semaphore	 = nullptr;
 	TaskHandle_t		m_motion_task		 = nullptr;
 	OnMotionCallback_t	m_on_motion_callback = nullptr;
+	OnIdleCallback_t	m_on_idle_callback	 = nullptr; // Sampling stopped, called by the motion task
+	esp_timer_handle_t	m_sample_timer		 = nullptr;
+	volatile uint32_t	m_sample_period_us	 = 1000000 / 125;
+	uint8_t*			m_burst_tx			 = nullptr; // DMA capable buffers for the motion burst read
+	uint8_t*			m_burst_rx			 = nullptr;
+	spi_stats			m_spi_stats			 = {};
+
+	spi_transaction_t m_batch[BATCH_SIZE] = {}; // Preallocated write descriptors
+	uint8_t*		  m_batch_buf		  = nullptr; // DMA capable payload, 2 bytes per descriptor
+	size_t			  m_batch_count		  = 0;
+	int				  m_batch_depth		  = 0;
+	int64_t			  m_bus_idle_at		  = 0; // Time (us) when the next access may start
+	bool			  m_legacy_io		  = false; // Write registers byte by byte (benchmark only)
+
+	// Shadow copy of the sensor registers, used to skip writes of unchanged values
+	SemaphoreHandle_t m_bus_mutex							= nullptr;
+	uint8_t			  m_bank								= 0xFF; // Bank selected on the sensor, 0xFF if unknown
+	uint8_t			  m_bank_selected						= 0;    // Bank selected by the driver
+	uint8_t			  m_shadow[SHADOW_BANKS][0x80]			= {};
+	uint32_t		  m_shadow_valid[SHADOW_BANKS][0x80 / 32] = {};
+	register_stats	  m_reg_stats							= {};
+
+	// Settings restored after the sensor is reset
+	uint16_t m_cpi_x	   = 600;
+	uint16_t m_cpi_y	   = 600;
+	uint8_t	 m_lift_height = 2;
+	uint8_t	 m_mode		   = 0;
+
+	// Sampler statistics. The window is updated by the motion task only,
+	// the published stats are copied under the lock.
+	struct
+	{
+		int64_t	 start;
+		int64_t	 last_report;
+		uint32_t reports;
+		uint32_t samples;
+		uint32_t intervals;
+		uint32_t interval_min;
+		uint32_t interval_max;
+		uint64_t deviation_sum;
+	} m_window					  = {};
+	sampler_stats m_sampler_stats = {};
+	portMUX_TYPE  m_stats_lock	  = portMUX_INITIALIZER_UNLOCKED;
+
+	// Power state tracking. The sensor downshifts by itself, the driver programs the
+	// downshift times and derives the state from the time since the last motion.
+	power_config	 m_power_config = {}; // Requested by set_power_config()
+	power_config	 m_power_times	= {}; // Programmed in the sensor, read back after every change
+	power_stats		 m_power_stats	= {};
+	int64_t			 m_idle_since	= 0; // 0 while sampling
+	int64_t			 m_run_since	= 0;
+	volatile int64_t m_wake_at		= 0;				 // Time of the last motion pin edge
+	int64_t			 m_wake_edge_at = 0;				 // Motion pin edge which ended the last idle period
+	power_state_t	 m_wake_state	= POWER_STATE_COUNT; // State left by the wake up, until the first report
+	int64_t			 m_power_time_us[POWER_STATE_COUNT] = {};
 
 public:
 	paw3395() {}
-	~paw3395() {}
+	~paw3395();
 
 	esp_err_t init(spi_host_device_t host_id, gpio_num_t ncs_pin, gpio_num_t pin_motion, uint16_t dpi,
-				   const OnMotionCallback_t& on_motion);
+				   const OnMotionCallback_t& on_motion, const OnIdleCallback_t& on_idle = nullptr);
 
 	/// @brief Set the lift cut height
 	/// @param lift_height The lift cut height: 0 - 1mm, 1 - 2mm
 	void set_lift_cut(uint8_t lift_height);
 
-	void set_dpi(uint16_t CPI_Num);
-	bool read_motion(int16_t* dx, int16_t* dy);
-	void motion_burst(motion_burst_data * values);
-	void office_mode();
-	void gaming_mode();
-	void low_power_mode();
-	void high_performance_mode();
+	/// @brief Set the resolution of both axes
+	void set_dpi(uint16_t cpi)
+	{
+		set_dpi(cpi, cpi);
+	}
+
+	/// @brief Set the resolution of each axis separately, in steps of 50 CPI
+	/// @param cpi_x Resolution of the sensor X axis
+	/// @param cpi_y Resolution of the sensor Y axis
+	void set_dpi(uint16_t cpi_x, uint16_t cpi_y);
+
+	/// @brief Set the motion sampling rate
+	/// @param rate_hz 125, 250, 500 or 1000 Hz
+	esp_err_t set_poll_rate(uint16_t rate_hz);
+
+	sampler_stats get_sampler_stats()
+	{
+		portENTER_CRITICAL(&m_stats_lock);
+		sampler_stats stats = m_sampler_stats;
+		portEXIT_CRITICAL(&m_stats_lock);
+		return stats;
+	}
+
+	/// @brief Read motion using the motion burst register (single bus transfer)
+	/// @param data Receives deltas, SQUAL, raw data sum and shutter
+	/// @return true if the sensor reported motion
+	bool read_motion(motion_data* data);
+	void motion_burst(motion_burst_data* values);
+
+	const spi_stats& get_spi_stats() const
+	{
+		return m_spi_stats;
+	}
+
+	const register_stats& get_register_stats() const
+	{
+		return m_reg_stats;
+	}
+
+	/// @brief Compare the register-by-register and the burst motion read paths.
+	/// Logs the number of SPI transactions and microseconds per sample for both.
+	/// @param samples Number of samples to read with each path
+	void benchmark_read_motion(uint32_t samples);
+
+	/// @brief Compare byte by byte register writes with the batched writes.
+	/// Applies the high performance mode sequence with both paths and logs the time spent.
+	/// @param iterations Number of times the sequence is written with each path
+	void benchmark_register_writes(uint32_t iterations);
+
+	/// @brief Apply the sensor mode register sequence and the operation mode bits
+	/// @param mode 0 - high performance, 1 - low power, 2 - office, 3 - corded gaming
+	/// @return ESP_ERR_INVALID_RESPONSE if the operation mode did not read back
+	esp_err_t set_mode(uint8_t mode);
+
+	/// @brief Capture one raw image frame of the sensor.
+	/// Motion reporting is paused during the capture, then the sensor is reset
+	/// and the current settings are applied again.
+	/// @param frame Receives FRAME_SIZE bytes, FRAME_WIDTH pixels per row
+	esp_err_t frame_grab(uint8_t* frame);
+
+	/// @brief Program the rest mode downshift times and frame periods.
+	/// Each register is read back to verify the switch.
+	esp_err_t set_power_config(const power_config& config);
+
+	power_state_t get_power_state();
+	power_stats	  get_power_stats();
+
+	static const char* power_state_name(power_state_t state);
 
 private:
 	void cs_high()
@@ -70,6 +267,7 @@ private:
 
 	void delay_ms(uint16_t nms)
 	{
+		flush_batch();
 		vTaskDelay(pdMS_TO_TICKS(nms));
 	}
 
@@ -79,12 +277,70 @@ private:
 	}
 
 	void		init_motion_pin();
+	void		apply_settings();
+	static void motion_isr_handler(void* arg);
 	static void motion_task(void* param);
+	void		sample_motion();
+	void		update_sampler_stats(int64_t now, bool moved, uint32_t period_us);
+	void		publish_sampler_stats(int64_t now);
+	void		on_wake();
+	void		on_idle();
+	void		account_idle(power_stats& stats, int64_t idle_us) const;
+	power_state_t power_state_at(int64_t idle_us) const;
+	esp_err_t	apply_power_config();
+	esp_err_t	verify_table(const paw3395_reg_table& table);
 
 	void	delay_125_ns(uint8_t nns);
 	uint8_t SPI_SendReceive(uint8_t data);
+	void	SPI_Transfer(const uint8_t* tx, uint8_t* rx, size_t len);
 	uint8_t read_register(uint8_t address, bool apply_cs = true);
-	void	write_register(uint8_t address, uint8_t value);
+	bool	write_register(uint8_t address, uint8_t value);
+	void	write_register_bytewise(uint8_t address, uint8_t value);
+	void	queue_write(uint8_t address, uint8_t value);
+	void	select_bank();
+	bool	is_cacheable(uint8_t address) const;
+	void	invalidate_shadow();
+	void	write_table(const paw3395_reg_table& table);
+
+	/// Register writes between begin_batch() and end_batch() are queued and sent
+	/// together. Reads and delays flush the queue first, so ordering is preserved.
+	void begin_batch()
+	{
+		m_batch_depth++;
+	}
+
+	void end_batch()
+	{
+		if(--m_batch_depth == 0)
+		{
+			flush_batch();
+		}
+	}
+
+	void flush_batch();
+	void wait_bus_idle();
+
+	// Serializes access to the sensor between the motion task and the configuration calls
+	class bus_lock
+	{
+		SemaphoreHandle_t m_mutex;
+	public:
+		bus_lock(SemaphoreHandle_t mutex) :
+			m_mutex(mutex)
+		{
+			xSemaphoreTakeRecursive(m_mutex, portMAX_DELAY);
+		}
+		~bus_lock()
+		{
+			xSemaphoreGiveRecursive(m_mutex);
+		}
+	};
+
+	void bus_busy_for(uint32_t us)
+	{
+		// +1 because esp_timer resolution is 1us
+		m_bus_idle_at = esp_timer_get_time() + us + 1;
+	}
 
 	void SPI_SendData(uint8_t data)
 	{
@@ -96,6 +352,8 @@ private:
 		return SPI_SendReceive(0xFF);
 	}
 
+	bool read_motion_registers(int16_t* dx, int16_t* dy);
+
 	void Power_up_sequence();
 	void Power_Up_Initializaton_Register_Setting();
 };
@@ -0,0 +1,280 @@
+#ifndef __PAW3395_TABLES_H__
+#define __PAW3395_TABLES_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// PAW3395 initialization and sensor mode register sequences.
+// Every entry is {bank, register, value}. The bank is selected with register 0x7F
+// by paw3395_write_table(), which switches banks only when the bank changes
+// and returns to bank 0 at the end of the table.
+
+struct paw3395_reg
+{
+	uint8_t bank;
+	uint8_t reg;
+	uint8_t value;
+};
+
+struct paw3395_reg_table
+{
+	const paw3395_reg* regs;
+	size_t			   count;
+};
+
+template <size_t N>
+constexpr paw3395_reg_table paw3395_make_table(const paw3395_reg (&regs)[N])
+{
+	return {regs, N};
+}
+
+// Write the table by write(register, value) calls, including the bank selects
+template <typename Write>
+void paw3395_write_table(const paw3395_reg_table& table, Write&& write)
+{
+	uint8_t bank = 0xFF; // unknown
+	for(size_t i = 0; i < table.count; i++)
+	{
+		const paw3395_reg& r = table.regs[i];
+		if(r.bank != bank)
+		{
+			bank = r.bank;
+			write(0x7F, bank);
+		}
+		write(r.reg, r.value);
+	}
+	if(bank != 0)
+	{
+		write(0x7F, 0x00);
+	}
+}
+
+// Power up initialization, written after POWER_UP_RESET
+constexpr paw3395_reg PAW3395_INIT_REGS[] = {
+	{0x07, 0x40, 0x41},
+	{0x00, 0x40, 0x80},
+	{0x0E, 0x55, 0x0D},
+	{0x0E, 0x56, 0x1B},
+	{0x0E, 0x57, 0xE8},
+	{0x0E, 0x58, 0xD5},
+	{0x14, 0x42, 0xBC},
+	{0x14, 0x43, 0x74},
+	{0x14, 0x4B, 0x20},
+	{0x14, 0x4D, 0x00},
+	{0x14, 0x53, 0x0E},
+	{0x05, 0x44, 0x04},
+	{0x05, 0x4D, 0x06},
+	{0x05, 0x51, 0x40},
+	{0x05, 0x53, 0x40},
+	{0x05, 0x55, 0xCA},
+	{0x05, 0x5A, 0xE8},
+	{0x05, 0x5B, 0xEA},
+	{0x05, 0x61, 0x31},
+	{0x05, 0x62, 0x64},
+	{0x05, 0x6D, 0xB8},
+	{0x05, 0x6E, 0x0F},
+	{0x05, 0x70, 0x02},
+	{0x05, 0x4A, 0x2A},
+	{0x05, 0x60, 0x26},
+	{0x06, 0x6D, 0x70},
+	{0x06, 0x6E, 0x60},
+	{0x06, 0x6F, 0x04},
+	{0x06, 0x53, 0x02},
+	{0x06, 0x55, 0x11},
+	{0x06, 0x7A, 0x01},
+	{0x06, 0x7D, 0x51},
+	{0x07, 0x41, 0x10},
+	{0x07, 0x42, 0x32},
+	{0x07, 0x43, 0x00},
+	{0x08, 0x71, 0x4F},
+	{0x09, 0x62, 0x1F},
+	{0x09, 0x63, 0x1F},
+	{0x09, 0x65, 0x03},
+	{0x09, 0x66, 0x03},
+	{0x09, 0x67, 0x1F},
+	{0x09, 0x68, 0x1F},
+	{0x09, 0x69, 0x03},
+	{0x09, 0x6A, 0x03},
+	{0x09, 0x6C, 0x1F},
+	{0x09, 0x6D, 0x1F},
+	{0x09, 0x51, 0x04},
+	{0x09, 0x53, 0x20},
+	{0x09, 0x54, 0x20},
+	{0x09, 0x71, 0x0C},
+	{0x09, 0x72, 0x07},
+	{0x09, 0x73, 0x07},
+	{0x0A, 0x4A, 0x14},
+	{0x0A, 0x4C, 0x14},
+	{0x0A, 0x55, 0x19},
+	{0x14, 0x4B, 0x30},
+	{0x14, 0x4C, 0x03},
+	{0x14, 0x61, 0x0B},
+	{0x14, 0x62, 0x0A},
+	{0x14, 0x63, 0x02},
+	{0x15, 0x4C, 0x02},
+	{0x15, 0x56, 0x02},
+	{0x15, 0x41, 0x91},
+	{0x15, 0x4D, 0x0A},
+	{0x0C, 0x4A, 0x10},
+	{0x0C, 0x4B, 0x0C},
+	{0x0C, 0x4C, 0x40},
+	{0x0C, 0x41, 0x25},
+	{0x0C, 0x55, 0x18},
+	{0x0C, 0x56, 0x14},
+	{0x0C, 0x49, 0x0A},
+	{0x0C, 0x42, 0x00},
+	{0x0C, 0x43, 0x2D},
+	{0x0C, 0x44, 0x0C},
+	{0x0C, 0x54, 0x1A},
+	{0x0C, 0x5A, 0x0D},
+	{0x0C, 0x5F, 0x1E},
+	{0x0C, 0x5B, 0x05},
+	{0x0C, 0x5E, 0x0F},
+	{0x0D, 0x48, 0xDD},
+	{0x0D, 0x4F, 0x03},
+	{0x0D, 0x52, 0x49},
+	{0x0D, 0x51, 0x00},
+	{0x0D, 0x54, 0x5B},
+	{0x0D, 0x53, 0x00},
+	{0x0D, 0x56, 0x64},
+	{0x0D, 0x55, 0x00},
+	{0x0D, 0x58, 0xA5},
+	{0x0D, 0x57, 0x02},
+	{0x0D, 0x5A, 0x29},
+	{0x0D, 0x5B, 0x47},
+	{0x0D, 0x5C, 0x81},
+	{0x0D, 0x5D, 0x40},
+	{0x0D, 0x71, 0xDC},
+	{0x0D, 0x70, 0x07},
+	{0x0D, 0x73, 0x00},
+	{0x0D, 0x72, 0x08},
+	{0x0D, 0x75, 0xDC},
+	{0x0D, 0x74, 0x07},
+	{0x0D, 0x77, 0x00},
+	{0x0D, 0x76, 0x08},
+	{0x10, 0x4C, 0xD0},
+	{0x00, 0x4F, 0x63},
+	{0x00, 0x4E, 0x00},
+	{0x00, 0x52, 0x63},
+	{0x00, 0x51, 0x00},
+	{0x00, 0x54, 0x54},
+	{0x00, 0x5A, 0x10},
+	{0x00, 0x77, 0x4F},
+	{0x00, 0x47, 0x01},
+	{0x00, 0x5B, 0x40},
+	{0x00, 0x64, 0x60},
+	{0x00, 0x65, 0x06},
+	{0x00, 0x66, 0x13},
+	{0x00, 0x67, 0x0F},
+	{0x00, 0x78, 0x01},
+	{0x00, 0x79, 0x9C},
+	{0x00, 0x40, 0x00},
+	{0x00, 0x55, 0x02},
+	{0x00, 0x23, 0x70},
+	{0x00, 0x22, 0x01},
+};
+
+// Written if the sensor does not report ready (0x6C == 0x80) during initialization
+constexpr paw3395_reg PAW3395_INIT_FALLBACK_REGS[] = {
+	{0x14, 0x6C, 0x00},
+};
+
+// Finishes the initialization after the ready check
+constexpr paw3395_reg PAW3395_INIT_FINISH_REGS[] = {
+	{0x00, 0x22, 0x00},
+	{0x00, 0x55, 0x00},
+	{0x07, 0x40, 0x40},
+};
+
+// High performance mode
+constexpr paw3395_reg PAW3395_HIGH_PERFORMANCE_MODE_REGS[] = {
+	{0x05, 0x51, 0x40},
+	{0x05, 0x53, 0x40},
+	{0x05, 0x61, 0x31},
+	{0x05, 0x6E, 0x0F},
+	{0x07, 0x42, 0x32},
+	{0x07, 0x43, 0x00},
+	{0x0D, 0x51, 0x00},
+	{0x0D, 0x52, 0x49},
+	{0x0D, 0x53, 0x00},
+	{0x0D, 0x54, 0x5B},
+	{0x0D, 0x55, 0x00},
+	{0x0D, 0x56, 0x64},
+	{0x0D, 0x57, 0x02},
+	{0x0D, 0x58, 0xA5},
+	{0x00, 0x54, 0x54},
+	{0x00, 0x78, 0x01},
+	{0x00, 0x79, 0x9C},
+};
+
+// Low power mode
+constexpr paw3395_reg PAW3395_LOW_POWER_MODE_REGS[] = {
+	{0x05, 0x51, 0x40},
+	{0x05, 0x53, 0x40},
+	{0x05, 0x61, 0x3B},
+	{0x05, 0x6E, 0x1F},
+	{0x07, 0x42, 0x32},
+	{0x07, 0x43, 0x00},
+	{0x0D, 0x51, 0x00},
+	{0x0D, 0x52, 0x49},
+	{0x0D, 0x53, 0x00},
+	{0x0D, 0x54, 0x5B},
+	{0x0D, 0x55, 0x00},
+	{0x0D, 0x56, 0x64},
+	{0x0D, 0x57, 0x02},
+	{0x0D, 0x58, 0xA5},
+	{0x00, 0x54, 0x54},
+	{0x00, 0x78, 0x01},
+	{0x00, 0x79, 0x9C},
+};
+
+// Office mode
+constexpr paw3395_reg PAW3395_OFFICE_MODE_REGS[] = {
+	{0x05, 0x51, 0x28},
+	{0x05, 0x53, 0x30},
+	{0x05, 0x61, 0x3B},
+	{0x05, 0x6E, 0x1F},
+	{0x07, 0x42, 0x32},
+	{0x07, 0x43, 0x00},
+	{0x0D, 0x51, 0x00},
+	{0x0D, 0x52, 0x49},
+	{0x0D, 0x53, 0x00},
+	{0x0D, 0x54, 0x5B},
+	{0x0D, 0x55, 0x00},
+	{0x0D, 0x56, 0x64},
+	{0x0D, 0x57, 0x02},
+	{0x0D, 0x58, 0xA5},
+	{0x00, 0x54, 0x52},
+	{0x00, 0x78, 0x0A},
+	{0x00, 0x79, 0x0F},
+};
+
+// Corded gaming mode
+constexpr paw3395_reg PAW3395_GAMING_MODE_REGS[] = {
+	{0x05, 0x51, 0x40},
+	{0x05, 0x53, 0x40},
+	{0x05, 0x61, 0x31},
+	{0x05, 0x6E, 0x0F},
+	{0x07, 0x42, 0x2F},
+	{0x07, 0x43, 0x00},
+	{0x0D, 0x51, 0x12},
+	{0x0D, 0x52, 0xDB},
+	{0x0D, 0x53, 0x12},
+	{0x0D, 0x54, 0xDC},
+	{0x0D, 0x55, 0x12},
+	{0x0D, 0x56, 0xEA},
+	{0x0D, 0x57, 0x15},
+	{0x0D, 0x58, 0x2D},
+	{0x00, 0x54, 0x55},
+	{0x00, 0x40, 0x83},
+};
+
+// Sensor modes, indexed by the operation mode of the Performance register (0x40 bits [1:0])
+constexpr paw3395_reg_table PAW3395_MODES[] = {
+	paw3395_make_table(PAW3395_HIGH_PERFORMANCE_MODE_REGS),
+	paw3395_make_table(PAW3395_LOW_POWER_MODE_REGS),
+	paw3395_make_table(PAW3395_OFFICE_MODE_REGS),
+	paw3395_make_table(PAW3395_GAMING_MODE_REGS),
+};
+
+#endif // __PAW3395_TABLES_H__
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include "paw3395.h"
+
+/// @brief Per second statistics of the surface quality and the shutter reported by the sensor.
+/// update() is called by the motion task for every sample with motion and idle() when the sensor
+/// stops sampling. They do not allocate and do not lock: the statistics are published after a second
+/// of motion or when the motion stops, with a sequence counter, and readers retry if they raced
+/// with the publication.
+class surface_telemetry
+{
+public:
+	struct stats
+	{
+		uint8_t	 squal_avg;
+		uint8_t	 squal_min;
+		uint8_t	 squal_max;
+		uint8_t	 raw_data_sum_avg;
+		uint16_t shutter_avg;
+		uint16_t samples;	 // Samples with motion, during a second at most
+		uint16_t suppressed; // Samples dropped because of the low surface quality
+		bool	 lifted;	 // The surface quality is below the threshold
+	};
+
+	// Surface quality must rise this much above the threshold to resume tracking
+	static constexpr uint8_t SQUAL_HYSTERESIS = 4;
+private:
+	// Updated by the motion task only
+	struct
+	{
+		int64_t	 start;
+		uint32_t squal_sum;
+		uint32_t raw_data_sum;
+		uint32_t shutter_sum;
+		uint16_t samples;
+		uint16_t suppressed;
+		uint8_t	 squal_min;
+		uint8_t	 squal_max;
+	} m_window					= {};
+	uint8_t				  m_threshold = 0;
+	bool				  m_lifted	  = false;
+
+	stats				  m_stats	  = {};
+	std::atomic<uint32_t> m_seq{0}; // Odd while m_stats is being written
+public:
+	/// @brief Set the surface quality below which the motion is suppressed
+	/// @param squal SQUAL threshold, 0 disables the suppression
+	void set_threshold(uint8_t squal)
+	{
+		m_threshold = squal;
+	}
+
+	/// @brief Account one sample
+	/// @return false if the motion of the sample must be dropped
+	bool update(const paw3395::motion_data& data, int64_t now)
+	{
+		if(m_window.start == 0)
+		{
+			m_window.start	   = now;
+			m_window.squal_min = UINT8_MAX;
+		}
+		m_window.samples++;
+		m_window.squal_sum += data.squal;
+		m_window.raw_data_sum += data.raw_data_sum;
+		m_window.shutter_sum += data.shutter;
+		m_window.squal_min = std::min(m_window.squal_min, data.squal);
+		m_window.squal_max = std::max(m_window.squal_max, data.squal);
+
+		if(m_lifted)
+		{
+			m_lifted = data.squal < m_threshold + SQUAL_HYSTERESIS;
+		} else
+		{
+			m_lifted = data.squal < m_threshold;
+		}
+		if(m_lifted)
+		{
+			m_window.suppressed++;
+		}
+
+		if(now - m_window.start >= 1000000)
+		{
+			publish();
+		}
+		return !m_lifted;
+	}
+
+	/// @brief Close the statistics when the sensor stops sampling
+	void idle()
+	{
+		// A lifted ball stops the motion reports, so nothing is suppressed anymore
+		bool lifted = m_lifted;
+		m_lifted	= false;
+		if(m_window.samples || lifted)
+		{
+			publish();
+		}
+	}
+
+	/// @brief Copy the statistics of the last complete second
+	/// @param seq Receives the publication number, it changes when new statistics are available
+	/// @return false if nothing was published yet
+	bool read(stats& out, uint32_t* seq = nullptr) const
+	{
+		uint32_t begin, end;
+		do
+		{
+			begin = m_seq.load(std::memory_order_acquire);
+			out	  = m_stats;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			end = m_seq.load(std::memory_order_relaxed);
+		} while((begin & 1) || begin != end);
+		if(seq)
+		{
+			*seq = begin;
+		}
+		return begin != 0;
+	}
+
+private:
+	void publish()
+	{
+		uint16_t n = m_window.samples;
+
+		m_seq.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		if(n)
+		{
+			// Without samples the values of the last motion are kept
+			m_stats.squal_avg		 = (uint8_t) (m_window.squal_sum / n);
+			m_stats.squal_min		 = m_window.squal_min;
+			m_stats.squal_max		 = m_window.squal_max;
+			m_stats.raw_data_sum_avg = (uint8_t) (m_window.raw_data_sum / n);
+			m_stats.shutter_avg		 = (uint16_t) (m_window.shutter_sum / n);
+		}
+		m_stats.samples			 = n;
+		m_stats.suppressed		 = m_window.suppressed;
+		m_stats.lifted			 = m_lifted;
+		m_seq.fetch_add(1, std::memory_order_release);
+
+		m_window = {};
+	}
+};
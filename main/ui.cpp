@@ -5,6 +5,10 @@
 #include "images/images.c"
 #include <esp_private/esp_clk.h>
 
+// Precision mode marker, right of the DPI line
+static const uint32_t PRECISION_X = 104;
+static const uint32_t PRECISION_Y = 48;
+
 trackball_ui::~trackball_ui()
 {
 	deinit();
@@ -73,6 +77,40 @@ void trackball_ui::set_battery_level(int bat_mV, int level)
 	}
 }
 
+void trackball_ui::set_surface_quality(int squal, bool lifted)
+{
+	if(m_squal == squal && m_lifted == lifted)
+		return;
+
+	m_squal	 = squal;
+	m_lifted = lifted;
+	draw_status_line();
+	ssd1306_show(&m_oled_data);
+}
+
+void trackball_ui::set_precision(bool active)
+{
+	if(m_precision == active)
+		return;
+
+	m_precision = active;
+	if(m_ui_state == UI_STATE_DEFAULT)
+	{
+		// Only the pages of the DPI line are sent, the button is held while the user aims
+		draw_precision();
+		ssd1306_show_pages(&m_oled_data, PRECISION_Y / 8, (PRECISION_Y + 15) / 8);
+	}
+}
+
+void trackball_ui::draw_precision()
+{
+	ssd1306_clear_square(&m_oled_data, PRECISION_X, PRECISION_Y, 128 - PRECISION_X, 16);
+	if(m_precision)
+	{
+		ssd1306_draw_string(&m_oled_data, PRECISION_X, PRECISION_Y, 2, "P");
+	}
+}
+
 void trackball_ui::draw_status_line()
 {
 	ssd1306_clear_square(&m_oled_data, 0, 0, 128, 15);
@@ -130,10 +168,21 @@ void trackball_ui::draw_status_line()
 		idx = 6;
 	ssd1306_bmp_show_image_with_offset(&m_oled_data, levels[idx].bmp, levels[idx].len, 111, 0);
 
-	// Draw battery percentage
+	// Draw surface quality after the longest RSSI text, a dirty ball shows as a low value
+	if(m_lifted)
+	{
+		ssd1306_draw_string(&m_oled_data, 62, 2, 1, "LIFT");
+	} else if(m_squal >= 0)
+	{
+		char squal_str[8] = {};
+		snprintf(squal_str, sizeof(squal_str), "Q%d", m_squal);
+		ssd1306_draw_string(&m_oled_data, 62, 2, 1, squal_str);
+	}
+
+	// Draw battery percentage, between the surface quality and the battery icon
 	char bat_str[10] = {};
-	snprintf(bat_str, sizeof(bat_str), " %3d%%", m_bat_level);
-	ssd1306_draw_string(&m_oled_data, 80, 2, 1, bat_str);
+	snprintf(bat_str, sizeof(bat_str), "%3d%%", m_bat_level);
+	ssd1306_draw_string(&m_oled_data, 86, 2, 1, bat_str);
 
 	// Draw separator line
 	ssd1306_draw_line(&m_oled_data, 0, 13, 128, 13);
@@ -183,6 +232,7 @@ void trackball_ui::draw_ui_default()
 
 	snprintf(str_draw, sizeof(str_draw), "DPI:%d", m_dpi);
 	ssd1306_draw_string(&m_oled_data, 0, 48, 2, str_draw);
+	draw_precision();
 }
 
 void trackball_ui::draw_ui_scroll_lock()
@@ -26,6 +26,9 @@ private:
 	int		   m_bat_mV			= 0;
 	int		   m_bat_level		= 0;
 	int		   m_dpi			= 600;
+	int		   m_squal			= -1; // Surface quality, -1 if unknown
+	bool	   m_lifted			= false;
+	bool	   m_precision		= false; // Precision mode is active
 	uint8_t	   m_scroll_mode	= SCROLL_MODE_HIGH_RES | SCROLL_MODE_ENABLE_HSCROLL | SCROLL_MODE_ENABLE_VSCROLL;
 public:
 	trackball_ui() = default;
@@ -54,6 +57,8 @@ public:
 			ssd1306_show(&m_oled_data);
 		}
 	}
+	void set_surface_quality(int squal, bool lifted);
+	void set_precision(bool active);
 	void set_dpi(int dpi)
 	{
 		m_dpi = dpi;
@@ -70,6 +75,7 @@ private:
 	void draw_ui_default();
 	void draw_ui_scroll_lock();
 	void draw_ui_lock_buttons();
+	void draw_precision();
 };
 
 #endif // _UI_H
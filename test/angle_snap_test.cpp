@@ -0,0 +1,153 @@
+// Checks angle_snap on traces of drags: near axis drags are straightened, the motion held across
+// the axis is released when the drag ends, and drags away from the axes pass unchanged.
+
+#include <cstdlib>
+
+#include "angle_snap.h"
+#include "motion_trace.h"
+#include "test_check.h"
+
+namespace
+{
+
+// Drag to the right along a text line, drifting down
+const trace_step HORIZONTAL_DRAG[] = {
+	{1, 5, 0}, {1, 3, 1}, {1, 5, 0}, {1, 4, 0}, {1, 5, 0}, {1, 4, 1},
+	{1, 6, 0}, {1, 6, 0}, {1, 6, 0}, {1, 6, 0}, {1, 6, 1}, {1, 6, 1},
+	{1, 7, 0}, {1, 8, 1}, {1, 9, 1}, {1, 7, 1}, {1, 7, 0}, {1, 8, 1},
+	{1, 10, 0}, {1, 10, 0}, {1, 10, -1}, {1, 10, 0}, {1, 9, 0}, {1, 9, -1},
+	{1, 12, 0}, {1, 12, 1}, {1, 10, -1}, {1, 11, 1}, {1, 12, 1}, {1, 13, 0},
+	{1, 12, 0}, {1, 13, 1}, {1, 13, 1}, {1, 11, 0}, {1, 12, 0}, {1, 11, -1},
+	{1, 10, 0}, {1, 9, 1}, {1, 11, 0}, {1, 11, -1}, {1, 9, 0}, {1, 8, 0},
+	{1, 8, 0}, {1, 7, -1}, {1, 9, 1}, {1, 8, 1}, {1, 6, 0}, {1, 6, 0},
+	{1, 7, 0}, {1, 8, 1}, {1, 6, 1}, {1, 6, -1}, {1, 6, -1}, {1, 4, 1},
+	{1, 5, 1}, {1, 4, 0}, {1, 5, 0}, {1, 3, 1}, {1, 4, -1}, {1, 3, 0},
+};
+
+// Drag up a column, drifting left
+const trace_step VERTICAL_DRAG[] = {
+	{1, 0, -5}, {1, 1, -5}, {1, -1, -3}, {1, -1, -5}, {1, -1, -5}, {1, 0, -6},
+	{1, 0, -7}, {1, 1, -7}, {1, 1, -6}, {1, -1, -6}, {1, 1, -6}, {1, -1, -7},
+	{1, -1, -7}, {1, 0, -8}, {1, 1, -8}, {1, 1, -8}, {1, -1, -8}, {1, -1, -8},
+	{1, 0, -11}, {1, -1, -9}, {1, 0, -10}, {1, 0, -11}, {1, 0, -9}, {1, 0, -8},
+	{1, -1, -9}, {1, -1, -7}, {1, 0, -7}, {1, 1, -9}, {1, 1, -6}, {1, 1, -7},
+	{1, -1, -8}, {1, -1, -7}, {1, -1, -7}, {1, -1, -7}, {1, 0, -6}, {1, 1, -5},
+	{1, -1, -6}, {1, 0, -4}, {1, 0, -4}, {1, 0, -4},
+};
+
+// Diagonal drag, far from both axes
+const trace_step DIAGONAL_DRAG[] = {
+	{1, 7, 7}, {1, 6, 6}, {1, 8, 8}, {1, 8, 6}, {1, 7, 8}, {1, 6, 4},
+	{1, 6, 5}, {1, 8, 8}, {1, 6, 7}, {1, 4, 4}, {1, 5, 7}, {1, 6, 6},
+	{1, 6, 5}, {1, 7, 6}, {1, 5, 5}, {1, 4, 5}, {1, 5, 4}, {1, 6, 7},
+	{1, 6, 7}, {1, 8, 8}, {1, 6, 4}, {1, 7, 8}, {1, 7, 6}, {1, 6, 7},
+	{1, 7, 6}, {1, 4, 4}, {1, 5, 5}, {1, 6, 6}, {1, 5, 6}, {1, 6, 6},
+	{1, 6, 8}, {1, 5, 7}, {1, 6, 6}, {1, 5, 6}, {1, 6, 4}, {1, 8, 7},
+	{1, 5, 5}, {1, 6, 5}, {1, 7, 7}, {1, 6, 4},
+};
+
+// Drag to the right turning downwards at about 65 degrees
+const trace_step HORIZONTAL_THEN_DOWN[] = {
+	{1, 9, 1}, {1, 11, 1}, {1, 9, 0}, {1, 10, 0}, {1, 11, 0}, {1, 11, 0},
+	{1, 11, 1}, {1, 10, 0}, {1, 10, 1}, {1, 9, 1}, {1, 11, 0}, {1, 9, 0},
+	{1, 10, 1}, {1, 11, 1}, {1, 11, 1}, {1, 10, 0}, {1, 9, 0}, {1, 9, 0},
+	{1, 9, 1}, {1, 11, 1}, {1, 11, 0}, {1, 10, 0}, {1, 9, 1}, {1, 11, 0},
+	{1, 11, 0}, {1, 10, 0}, {1, 11, 0}, {1, 10, 0}, {1, 10, 0}, {1, 10, 0},
+	{1, 5, 11}, {1, 4, 11}, {1, 5, 9}, {1, 4, 11}, {1, 4, 9}, {1, 4, 11},
+	{1, 4, 11}, {1, 5, 10}, {1, 4, 9}, {1, 4, 10}, {1, 5, 9}, {1, 5, 10},
+	{1, 5, 10}, {1, 4, 10}, {1, 4, 9}, {1, 4, 11}, {1, 4, 10}, {1, 4, 11},
+	{1, 4, 9}, {1, 4, 10}, {1, 4, 9}, {1, 4, 9}, {1, 5, 11}, {1, 5, 11},
+	{1, 5, 11}, {1, 5, 11}, {1, 4, 10}, {1, 4, 9}, {1, 4, 11}, {1, 5, 9},
+};
+
+angle_snap make_snap()
+{
+	return make_stage<angle_snap>(true, 8);
+}
+
+// Replay a whole drag, then the pause which ends it
+template <size_t N>
+trace_travel replay_drag(angle_snap& snap, int64_t& now, const trace_step (&trace)[N])
+{
+	return replay_trace(snap, now, trace, 0, N, true);
+}
+
+void test_horizontal_drag()
+{
+	angle_snap	 snap = make_snap();
+	int64_t		 now  = 1000000;
+	trace_travel t	  = replay_drag(snap, now, HORIZONTAL_DRAG);
+	CHECK_EQ(t.out_x, t.in_x);
+	// Everything held across the axis comes out once, when the drag ends
+	CHECK_EQ(t.out_y, t.in_y);
+	CHECK(t.in_y > 10);
+	CHECK(t.release_tick > 0);
+	CHECK(t.release_tick * TRACE_TICK_US > angle_snap::IDLE_US);
+	CHECK(t.release_tick * TRACE_TICK_US <= angle_snap::IDLE_US + TRACE_TICK_US);
+	CHECK(!snap.pending());
+}
+
+void test_drag_ends_before_next_one()
+{
+	// The next drag starts with its own motion, not with the motion held by the previous one
+	angle_snap snap = make_snap();
+	int64_t	   now	= 1000000;
+	replay_drag(snap, now, HORIZONTAL_DRAG);
+	now += 300000;
+	motion_sample s = {};
+	now += 1000;
+	s.x	   = 0;
+	s.y	   = 5;
+	s.time = now;
+	snap.process(s);
+	CHECK_EQ(s.x, 0);
+	CHECK_EQ(s.y, 5);
+}
+
+void test_vertical_drag()
+{
+	angle_snap snap = make_snap();
+	int64_t	   now	= 1000000;
+	// Straight while the drag lasts
+	trace_travel during = replay_trace(snap, now, VERTICAL_DRAG, 0, 20);
+	CHECK_EQ(snap.axis(), angle_snap::AXIS_Y);
+	trace_travel rest = replay_trace(snap, now, VERTICAL_DRAG, 20, 40, true);
+	CHECK_EQ(during.out_y, during.in_y);
+	CHECK_EQ(during.out_x + rest.out_x, during.in_x + rest.in_x);
+}
+
+void test_diagonal_drag()
+{
+	angle_snap	 snap = make_snap();
+	int64_t		 now  = 1000000;
+	trace_travel t	  = replay_drag(snap, now, DIAGONAL_DRAG);
+	CHECK_EQ(snap.axis(), angle_snap::AXIS_NONE);
+	CHECK_EQ(t.out_x, t.in_x);
+	CHECK_EQ(t.out_y, t.in_y);
+	CHECK_EQ(t.release_tick, 0);
+}
+
+void test_turn_releases_at_once()
+{
+	// Leaving the axis releases the held motion with the motion, no pause is needed
+	angle_snap	 snap	= make_snap();
+	int64_t		 now	= 1000000;
+	trace_travel before = replay_trace(snap, now, HORIZONTAL_THEN_DOWN, 0, 30);
+	CHECK_EQ(snap.axis(), angle_snap::AXIS_X);
+	trace_travel after = replay_trace(snap, now, HORIZONTAL_THEN_DOWN, 30, 60);
+	CHECK_EQ(before.out_x + after.out_x, before.in_x + after.in_x);
+	CHECK_EQ(before.out_y + after.out_y, before.in_y + after.in_y);
+	CHECK(!snap.pending());
+}
+
+} // namespace
+
+int main()
+{
+	test_horizontal_drag();
+	test_drag_ends_before_next_one();
+	test_vertical_drag();
+	test_diagonal_drag();
+	test_turn_releases_at_once();
+	return test_result();
+}
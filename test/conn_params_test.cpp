@@ -0,0 +1,250 @@
+// Connection parameter levels driven by activity and the periodic tick.
+// The fake central accepts or refuses each requested update, the test controls the clock.
+
+#include <cstdint>
+
+#include "conn_params.h"
+#include "host/ble_gap.h"
+#include "test_check.h"
+
+namespace
+{
+const uint16_t CONN_HANDLE = 1;
+
+int64_t			   g_now_us = 0;
+int				   g_requests;		 // ble_gap_update_params() calls
+ble_gap_upd_params g_requested;		 // parameters of the last call
+ble_gap_conn_desc  g_desc;			 // parameters the connection uses
+int				   g_update_rc = 0; // result of the next ble_gap_update_params()
+
+void advance_ms(int64_t ms)
+{
+	g_now_us += ms * 1000;
+}
+
+// the central applies the requested parameters and the stack reports BLE_GAP_EVENT_CONN_UPDATE
+void accept_update()
+{
+	g_desc.conn_itvl	= g_requested.itvl_max;
+	g_desc.conn_latency = g_requested.latency;
+	conn_params_updated(CONN_HANDLE, 0);
+}
+
+// one second of the connection state timer
+void tick_s(int seconds)
+{
+	for(int i = 0; i < seconds; ++i)
+	{
+		advance_ms(1000);
+		conn_params_tick();
+	}
+}
+
+conn_params_stats stats()
+{
+	conn_params_stats s;
+	conn_params_get_stats(&s);
+	return s;
+}
+
+void connect()
+{
+	g_requests	= 0;
+	g_update_rc = 0;
+	conn_params_disconnected();
+	conn_params_set_idle(5000, 60000);
+	conn_params_connected(CONN_HANDLE);
+	accept_update();
+}
+
+void test_connect_requests_active()
+{
+	connect();
+	CHECK_EQ(g_requests, 1);
+	CHECK_EQ(g_requested.latency, 0);
+	CHECK_EQ(stats().level, CONN_LEVEL_ACTIVE);
+	CHECK_EQ(stats().latency, 0);
+}
+
+void test_idle_steps_down_on_tick()
+{
+	connect();
+	tick_s(4);
+	CHECK_EQ(g_requests, 1);
+
+	tick_s(1);
+	CHECK_EQ(g_requests, 2);
+	CHECK_EQ(stats().level, CONN_LEVEL_IDLE);
+	CHECK_EQ(g_requested.latency, 29);
+	accept_update();
+
+	tick_s(54);
+	CHECK_EQ(g_requests, 2);
+	tick_s(1);
+	CHECK_EQ(g_requests, 3);
+	CHECK_EQ(stats().level, CONN_LEVEL_SLEEP);
+	accept_update();
+	CHECK_EQ(stats().itvl, 0x3C);
+	CHECK_EQ(stats().updates, 3);
+}
+
+void test_activity_returns_to_active()
+{
+	connect();
+	tick_s(5);
+	accept_update();
+	tick_s(55);
+	accept_update();
+	CHECK_EQ(stats().level, CONN_LEVEL_SLEEP);
+	ble_gap_upd_params active = {0x06, 0x0A, 0, 42};
+
+	// The first motion after sleep asks for the fast parameters at once, not on the next tick
+	advance_ms(3);
+	int requests = g_requests;
+	conn_params_activity();
+	CHECK_EQ(g_requests, requests + 1);
+	CHECK_EQ(g_requested.itvl_min, active.itvl_min);
+	CHECK_EQ(g_requested.itvl_max, active.itvl_max);
+	CHECK_EQ(g_requested.latency, active.latency);
+	CHECK_EQ(stats().level, CONN_LEVEL_ACTIVE);
+
+	// More motion while the update is negotiated does not request it again
+	conn_params_activity();
+	CHECK_EQ(g_requests, requests + 1);
+
+	advance_ms(70);
+	accept_update();
+	CHECK_EQ(stats().itvl, 0x0A);
+	CHECK_EQ(stats().latency, 0);
+	CHECK_EQ(stats().renegotiate_us, 70000);
+
+	advance_ms(2);
+	conn_params_report_sent();
+	CHECK_EQ(stats().wake_latency_us, 72000);
+
+	// The tick keeps the fast parameters while the ball moves
+	for(int i = 0; i < 10; ++i)
+	{
+		tick_s(1);
+		conn_params_activity();
+	}
+	CHECK_EQ(g_requests, requests + 1);
+	CHECK_EQ(stats().level, CONN_LEVEL_ACTIVE);
+}
+
+void test_activity_during_step_down()
+{
+	connect();
+	tick_s(5);
+	CHECK_EQ(stats().level, CONN_LEVEL_IDLE);
+
+	// Only one update runs at a time, the fast parameters follow the completed step down
+	int requests = g_requests;
+	conn_params_activity();
+	CHECK_EQ(g_requests, requests);
+	accept_update();
+	CHECK_EQ(g_requests, requests + 1);
+	CHECK_EQ(g_requested.latency, 0);
+	CHECK_EQ(stats().level, CONN_LEVEL_ACTIVE);
+	accept_update();
+	CHECK_EQ(stats().latency, 0);
+}
+
+void test_refused_step_down_is_retried_later()
+{
+	connect();
+	tick_s(5);
+	CHECK_EQ(stats().level, CONN_LEVEL_IDLE);
+	conn_params_updated(CONN_HANDLE, 1);
+	CHECK_EQ(stats().level, CONN_LEVEL_ACTIVE);
+	CHECK_EQ(stats().failures, 1);
+
+	int requests = g_requests;
+	tick_s(29);
+	CHECK_EQ(g_requests, requests);
+	tick_s(1);
+	CHECK_EQ(g_requests, requests + 1);
+	CHECK_EQ(stats().level, CONN_LEVEL_IDLE);
+
+	// A refused step down never holds back the fast parameters
+	conn_params_updated(CONN_HANDLE, 1);
+	conn_params_activity();
+	CHECK_EQ(stats().level, CONN_LEVEL_ACTIVE);
+}
+
+void test_lost_update_event()
+{
+	connect();
+	tick_s(5);
+	int requests = g_requests;
+
+	// No BLE_GAP_EVENT_CONN_UPDATE arrives, the tick gives the request up and tries again
+	tick_s(10);
+	CHECK_EQ(g_requests, requests);
+	tick_s(1);
+	CHECK_EQ(stats().failures, 1);
+	CHECK_EQ(g_requests, requests + 1);
+	CHECK_EQ(stats().level, CONN_LEVEL_IDLE);
+}
+
+void test_request_error()
+{
+	connect();
+	tick_s(5);
+	accept_update();
+
+	g_update_rc = 1;
+	conn_params_activity();
+	CHECK_EQ(stats().level, CONN_LEVEL_IDLE);
+	CHECK_EQ(stats().failures, 1);
+
+	// The next motion tries again, the retry delay only holds back step downs
+	g_update_rc = 0;
+	advance_ms(10);
+	conn_params_activity();
+	CHECK_EQ(stats().level, CONN_LEVEL_ACTIVE);
+}
+
+void test_disconnected()
+{
+	connect();
+	conn_params_disconnected();
+	int requests = g_requests;
+	tick_s(120);
+	conn_params_activity();
+	CHECK_EQ(g_requests, requests);
+}
+} // namespace
+
+extern "C" int64_t esp_timer_get_time(void)
+{
+	return g_now_us;
+}
+
+extern "C" int ble_gap_update_params(uint16_t conn_handle, const struct ble_gap_upd_params* params)
+{
+	CHECK_EQ(conn_handle, CONN_HANDLE);
+	g_requests++;
+	g_requested = *params;
+	return g_update_rc;
+}
+
+extern "C" int ble_gap_conn_find(uint16_t handle, struct ble_gap_conn_desc* out_desc)
+{
+	*out_desc			  = g_desc;
+	out_desc->conn_handle = handle;
+	return 0;
+}
+
+int main()
+{
+	test_connect_requests_active();
+	test_idle_steps_down_on_tick();
+	test_activity_returns_to_active();
+	test_activity_during_step_down();
+	test_refused_step_down_is_retried_later();
+	test_lost_update_event();
+	test_request_error();
+	test_disconnected();
+	return test_result();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF log macros, the arguments are checked but nothing is printed
+
+#include <stdio.h>
+
+#define ESP_LOG_DISCARD(tag, ...)   \
+	do                              \
+	{                               \
+		(void) (tag);               \
+		if(0)                       \
+			printf(__VA_ARGS__);    \
+	} while(0)
+
+#define ESP_LOGE(tag, ...) ESP_LOG_DISCARD(tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ESP_LOG_DISCARD(tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ESP_LOG_DISCARD(tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ESP_LOG_DISCARD(tag, __VA_ARGS__)
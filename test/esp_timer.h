@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF timer, the test owns the clock
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	int64_t esp_timer_get_time(void); // microseconds, implemented by the test
+
+#ifdef __cplusplus
+}
+#endif
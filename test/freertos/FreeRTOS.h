@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS spinlock used by the shared nimble headers, a test thread spins like the other core
+
+typedef struct
+{
+	unsigned char locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED \
+	{                                \
+		0                            \
+	}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#define taskENTER_CRITICAL(mux)                                      \
+	do                                                               \
+	{                                                                \
+	} while(__atomic_test_and_set(&(mux)->locked, __ATOMIC_ACQUIRE))
+
+#define taskEXIT_CRITICAL(mux) __atomic_clear(&(mux)->locked, __ATOMIC_RELEASE)
@@ -0,0 +1,33 @@
+#pragma once
+
+// Host stand-in for the NimBLE GAP API used by conn_params.c, the test implements the functions
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	struct ble_gap_upd_params
+	{
+		uint16_t itvl_min;
+		uint16_t itvl_max;
+		uint16_t latency;
+		uint16_t supervision_timeout;
+	};
+
+	struct ble_gap_conn_desc
+	{
+		uint16_t conn_handle;
+		uint16_t conn_itvl;
+		uint16_t conn_latency;
+		uint16_t supervision_timeout;
+	};
+
+	int ble_gap_update_params(uint16_t conn_handle, const struct ble_gap_upd_params* params);
+	int ble_gap_conn_find(uint16_t handle, struct ble_gap_conn_desc* out_desc);
+
+#ifdef __cplusplus
+}
+#endif
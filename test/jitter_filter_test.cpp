@@ -0,0 +1,210 @@
+// The jitter filter lags behind the ball. When the ball stops, the lag must still reach the host:
+// the report task passes samples without motion while the pipeline is pending.
+
+#include <chrono>
+#include <cstdlib>
+
+#include "jitter_filter.h"
+#include "motion_pipeline.h"
+#include "motion_scaler.h"
+#include "motion_trace.h"
+#include "test_check.h"
+
+namespace
+{
+
+using filter_pipeline = motion_pipeline<motion_scaler, jitter_filter>;
+
+struct stroke_result
+{
+	int64_t out_x;
+	int64_t out_y;
+	int		drain_ticks;
+};
+
+// Samples of (dx, dy) every sample_us, then empty samples while the pipeline is pending
+stroke_result stroke(filter_pipeline& pipeline, int64_t& now, int samples, int32_t dx, int32_t dy, uint32_t sample_us)
+{
+	stroke_result r = {};
+	for(int i = 0; i < samples; i++)
+	{
+		motion_sample s = {};
+		now += sample_us;
+		s.x		= dx;
+		s.y		= dy;
+		s.dt_us = sample_us;
+		s.time	= now;
+		pipeline.process(s);
+		r.out_x += s.x;
+		r.out_y += s.y;
+	}
+	while(pipeline.pending() && r.drain_ticks < 100000)
+	{
+		motion_sample s = {};
+		now += sample_us;
+		s.dt_us = sample_us;
+		s.time	= now;
+		pipeline.process(s);
+		r.out_x += s.x;
+		r.out_y += s.y;
+		r.drain_ticks++;
+	}
+	return r;
+}
+
+filter_pipeline make_pipeline()
+{
+	filter_pipeline pipeline;
+	pipeline.stage<jitter_filter>().set(true, 100, 70);
+	return pipeline;
+}
+
+void test_stroke_reaches_the_end()
+{
+	for(uint32_t sample_us : {1000u, 8000u})
+	{
+		filter_pipeline pipeline = make_pipeline();
+		int64_t			now		 = 1000000;
+		// 300 counts to the right, 150 up
+		stroke_result r = stroke(pipeline, now, 30, 10, -5, sample_us);
+		std::printf("%u us samples: %lld, %lld counts after %d drain ticks\n", sample_us, (long long) r.out_x,
+					(long long) r.out_y, r.drain_ticks);
+		// The fraction of a count below zero may stay in the remainder
+		CHECK(r.out_x >= 299 && r.out_x <= 300);
+		CHECK(r.out_y >= -150 && r.out_y <= -149);
+		CHECK(!pipeline.pending());
+		// The pointer keeps creeping only as long as the filter time constant at rest
+		CHECK((int64_t) r.drain_ticks * sample_us < 1500000);
+	}
+}
+
+void test_strokes_after_pauses()
+{
+	// The counts of consecutive strokes add up, nothing is dropped by the pauses between them
+	filter_pipeline pipeline = make_pipeline();
+	int64_t			now		 = 1000000;
+	int64_t			total	 = 0;
+	for(int i = 0; i < 20; i++)
+	{
+		int32_t dx = (i & 1) ? -7 : 13;
+		total += stroke(pipeline, now, 10 + i, dx, 0, 1000).out_x;
+		now += 50000 * (i % 4);
+	}
+	int64_t expected = 0;
+	for(int i = 0; i < 20; i++)
+	{
+		expected += (int64_t) ((i & 1) ? -7 : 13) * (10 + i);
+	}
+	CHECK(total >= expected - 1 && total <= expected);
+}
+
+void test_noise_at_rest()
+{
+	// Alternating noise is still smoothed, and the drain brings the pointer back to the raw position
+	filter_pipeline pipeline = make_pipeline();
+	int64_t			now		 = 1000000;
+	int64_t			out		 = 0;
+	int				moves	 = 0;
+	for(int i = 0; i < 200; i++)
+	{
+		motion_sample s = {};
+		now += 1000;
+		s.x		= (i & 1) ? 1 : -1;
+		s.dt_us = 1000;
+		s.time	= now;
+		pipeline.process(s);
+		out += s.x;
+		moves += s.x != 0;
+	}
+	CHECK(moves < 20);
+	out += stroke(pipeline, now, 0, 0, 0, 1000).out_x;
+	CHECK(out >= -1 && out <= 0);
+}
+
+void test_disabled()
+{
+	filter_pipeline pipeline;
+	int64_t			now = 1000000;
+	stroke_result	r	= stroke(pipeline, now, 30, 10, -5, 1000);
+	CHECK_EQ(r.out_x, 300);
+	CHECK_EQ(r.out_y, -150);
+	CHECK_EQ(r.drain_ticks, 0);
+}
+
+void test_step_lag()
+{
+	// The ball starts at a constant speed: how many 1 ms samples until the output follows at 90% of it,
+	// and how far the pointer trails behind the ball once it does
+	int		settle[3];
+	int64_t lag_us[3];
+	int		n = 0;
+	for(int32_t speed : {1, 10, 100})
+	{
+		jitter_filter filter = make_stage<jitter_filter>(true, 100, 70);
+		int64_t		  now	 = 1000000;
+		int64_t		  in	 = 0;
+		int64_t		  out	 = 0;
+		int			  delay	 = -1;
+		for(int i = 1; i <= 2000; i++)
+		{
+			motion_sample s = {};
+			now += 1000;
+			s.x		= speed;
+			s.dt_us = 1000;
+			s.time	= now;
+			filter.process(s);
+			in += speed;
+			out += s.x;
+			if(delay < 0 && s.x * 10 >= speed * 9)
+			{
+				delay = i;
+			}
+		}
+		int64_t lag = in - out;
+		std::printf("step of %d counts/ms: output at 90%% after %d samples, lag %lld counts = %.2f ms\n", speed, delay,
+					(long long) lag, (double) lag / speed);
+		CHECK(delay > 0);
+		settle[n]	= delay;
+		lag_us[n++] = lag * 1000 / speed;
+		// The steady lag stays bounded, it is owed and drained when the ball stops
+		CHECK(lag >= 0 && lag / speed < 200);
+	}
+	// Faster motion raises the cutoff, the pointer trails the ball by less time
+	CHECK(lag_us[1] < lag_us[0]);
+	CHECK(lag_us[2] < lag_us[1]);
+	CHECK(settle[2] <= 20);
+}
+
+void test_cost()
+{
+	// Host time per sample, the on-device benchmark reports cycles of the same loop
+	jitter_filter filter = make_stage<jitter_filter>(true, 100, 70);
+	const int	  samples = 2000000;
+	int64_t		  sum	  = 0;
+	auto		  start	  = std::chrono::steady_clock::now();
+	for(int i = 0; i < samples; i++)
+	{
+		int32_t x = (i & 0x3F) - 32;
+		int32_t y = ((i >> 6) & 0x3F) - 32;
+		filter.process(x, y, 1000);
+		sum += x + y;
+	}
+	auto   elapsed = std::chrono::steady_clock::now() - start;
+	double ns	   = std::chrono::duration<double, std::nano>(elapsed).count() / samples;
+	std::printf("jitter filter: %.1f ns per sample (checksum %lld)\n", ns, (long long) sum);
+	// Loose enough for a loaded build machine, it catches an accidental slow path
+	CHECK(ns < 2000);
+}
+
+} // namespace
+
+int main()
+{
+	test_stroke_reaches_the_end();
+	test_strokes_after_pauses();
+	test_noise_at_rest();
+	test_disabled();
+	test_step_lag();
+	test_cost();
+	return test_result();
+}
@@ -0,0 +1,86 @@
+// Pointer acceleration of merged samples. The report task merges the samples queued during a radio
+// stall, the gain of the merged motion must match the gain of the samples processed one by one.
+
+#include <cstdlib>
+
+#include "motion_accel.h"
+#include "motion_queue.h"
+#include "test_check.h"
+
+namespace
+{
+
+const uint32_t SAMPLE_US = 1000;
+
+motion_accel make_accel()
+{
+	accel_config cfg;
+	cfg.curve = ACCEL_CURVE_NATURAL;
+	motion_accel accel;
+	accel.set(cfg);
+	accel.set_resolution(1600);
+	return accel;
+}
+
+void test_merged_samples()
+{
+	for(int32_t per_sample : {2, 9, 25, 60})
+	{
+		for(uint32_t n : {2u, 4u, 8u})
+		{
+			motion_accel separate = make_accel();
+			int32_t		 sum	  = 0;
+			for(uint32_t i = 0; i < n; i++)
+			{
+				int32_t x = per_sample, y = 0;
+				separate.process(x, y, SAMPLE_US);
+				sum += x;
+			}
+
+			motion_queue queue;
+			for(uint32_t i = 0; i < n; i++)
+			{
+				queue.push((int16_t) per_sample, 0);
+			}
+			int32_t	 x, y;
+			uint32_t samples = 0;
+			CHECK(queue.pop_all(x, y, samples));
+			CHECK_EQ(samples, n);
+			motion_accel merged = make_accel();
+			merged.process(x, y, samples * SAMPLE_US);
+
+			// Only the carried fraction may differ
+			if(std::abs(x - sum) > 1)
+			{
+				std::printf("%u samples of %d counts: %d separately, %d merged\n", n, per_sample, sum, x);
+				g_test_failures++;
+			}
+		}
+	}
+}
+
+void test_overflow_samples()
+{
+	// Samples merged in the overflow accumulator count too
+	motion_queue queue;
+	for(uint32_t i = 0; i < motion_queue::SIZE + 10; i++)
+	{
+		queue.push(1, -1);
+	}
+	int32_t	 x, y;
+	uint32_t samples = 0;
+	CHECK(queue.pop_all(x, y, samples));
+	CHECK_EQ(samples, motion_queue::SIZE + 10);
+	CHECK_EQ(x, motion_queue::SIZE + 10);
+	CHECK_EQ(y, -(int32_t) (motion_queue::SIZE + 10));
+	CHECK(!queue.pop_all(x, y, samples));
+}
+
+} // namespace
+
+int main()
+{
+	test_merged_samples();
+	test_overflow_samples();
+	return test_result();
+}
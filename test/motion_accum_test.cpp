@@ -0,0 +1,131 @@
+// Replays notification failure patterns through the motion accumulator of hid_mouse_send_report()
+// and checks that the host receives the whole displacement, also when the motion exceeds the
+// 16 bit report fields.
+
+#include <random>
+#include <vector>
+
+#include "motion_accum.h"
+#include "motion_transform.h"
+#include "test_check.h"
+
+namespace
+{
+
+struct host_totals
+{
+	int64_t dx, dy, wheel, ac_pan;
+	int		reports;
+};
+
+// The accumulator part of hid_mouse_send_report(), the notification outcome is given
+struct mouse_sender
+{
+	motion_accum pending = {};
+	host_totals	 host	 = {};
+
+	void send(int32_t dx, int32_t dy, int32_t wheel, int32_t ac_pan, bool delivered)
+	{
+		int16_t x, y, w, p;
+		motion_accum_add(&pending, dx, dy, wheel, ac_pan);
+		motion_accum_take(&pending, &x, &y, &w, &p);
+		for(int16_t v : {x, y, w, p})
+		{
+			CHECK(v >= -INT16_MAX);
+		}
+		if(!delivered)
+		{
+			motion_accum_add(&pending, x, y, w, p);
+			return;
+		}
+		host.dx += x;
+		host.dy += y;
+		host.wheel += w;
+		host.ac_pan += p;
+		host.reports++;
+	}
+
+	// The report task resends while something is pending
+	void drain()
+	{
+		while(!motion_accum_empty(&pending))
+		{
+			send(0, 0, 0, 0, true);
+		}
+	}
+};
+
+void replay(const char* name, const std::vector<bool>& delivered, int32_t max_delta)
+{
+	std::mt19937 rng(7);
+	mouse_sender sender;
+	host_totals	 in = {};
+	for(bool ok : delivered)
+	{
+		auto	random = [&]() { return (int32_t) (rng() % (2 * max_delta + 1)) - max_delta; };
+		int32_t dx = random(), dy = random(), w = random() / 16, p = random() / 16;
+		in.dx += dx;
+		in.dy += dy;
+		in.wheel += w;
+		in.ac_pan += p;
+		sender.send(dx, dy, w, p, ok);
+	}
+	sender.drain();
+	std::printf("%s: %zu sends, %d reports delivered\n", name, delivered.size(), sender.host.reports);
+	CHECK_EQ(sender.host.dx, in.dx);
+	CHECK_EQ(sender.host.dy, in.dy);
+	CHECK_EQ(sender.host.wheel, in.wheel);
+	CHECK_EQ(sender.host.ac_pan, in.ac_pan);
+}
+
+void test_failure_patterns()
+{
+	const int			 N = 2000;
+	std::vector<bool>	 all_ok(N, true), alternate(N), bursts(N), random(N), stalled(N, false);
+	std::mt19937		 rng(11);
+	for(int i = 0; i < N; i++)
+	{
+		alternate[i] = i & 1;
+		bursts[i]	 = (i / 50) % 3 == 0; // 50 delivered, 100 refused
+		random[i]	 = rng() % 10 >= 3;
+	}
+	stalled.back() = true;
+	for(int32_t max_delta : {40, 30000, 100000})
+	{
+		replay("all delivered", all_ok, max_delta);
+		replay("alternate", alternate, max_delta);
+		replay("bursts", bursts, max_delta);
+		replay("random 30% refused", random, max_delta);
+		replay("stalled", stalled, max_delta);
+	}
+}
+
+void test_large_motion_through_transform()
+{
+	// A coalesced flick beyond 16 bits keeps its length through the rotation and the reports
+	mouse_sender	 sender;
+	motion_transform transform;
+	transform.set(90, true, false);
+	int64_t in_x = 0, in_y = 0;
+	for(int32_t d : {40000, -70000, 123456, 5})
+	{
+		int32_t x = d, y = d / 3;
+		in_x += d;
+		in_y += d / 3;
+		transform.process(x, y);
+		sender.send(x, y, 0, 0, true);
+	}
+	sender.drain();
+	// Rotated by 90 degrees and mirrored in X: x' = y, y' = x
+	CHECK_EQ(sender.host.dx, in_y);
+	CHECK_EQ(sender.host.dy, in_x);
+}
+
+} // namespace
+
+int main()
+{
+	test_failure_patterns();
+	test_large_motion_through_transform();
+	return test_result();
+}
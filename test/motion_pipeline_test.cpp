@@ -0,0 +1,289 @@
+// Composition of the stages: the pipelines of app.h against the same stages called one by one,
+// the order of the template arguments, stage<T>() access, pending(), flush() and reset() over all stages.
+
+#include <random>
+
+#include "angle_snap.h"
+#include "jitter_filter.h"
+#include "motion_accel.h"
+#include "motion_pipeline.h"
+#include "motion_scaler.h"
+#include "motion_transform.h"
+#include "precision_scaler.h"
+#include "scroll_axis_lock.h"
+#include "test_check.h"
+
+namespace
+{
+
+const uint32_t SENSOR_DPI = 1600;
+const uint32_t SAMPLE_US  = 1000;
+
+// Same as app::pointer_pipeline and app::scroll_pipeline
+using pointer_pipeline =
+	motion_pipeline<motion_scaler, jitter_filter, motion_accel, precision_scaler, motion_transform, angle_snap>;
+using scroll_pipeline = motion_pipeline<motion_scaler, motion_transform, scroll_axis_lock>;
+
+// The stages of pointer_pipeline called in order, as before the pipeline existed
+struct pointer_stages
+{
+	motion_scaler	 scaler;
+	jitter_filter	 jitter;
+	motion_accel	 accel;
+	precision_scaler precision;
+	motion_transform transform;
+	angle_snap		 snap;
+
+	void process(motion_sample& s)
+	{
+		scaler.process(s);
+		jitter.process(s);
+		accel.process(s);
+		precision.process(s);
+		transform.process(s);
+		snap.process(s);
+	}
+};
+
+void configure_pointer(motion_scaler& scaler, jitter_filter& jitter, motion_accel& accel, precision_scaler& precision,
+					   motion_transform& transform, angle_snap& snap)
+{
+	accel_config cfg;
+	cfg.curve = ACCEL_CURVE_NATURAL;
+	scaler.set_ratio(1200, 1000, SENSOR_DPI);
+	jitter.set(true, 100, 70);
+	accel.set(cfg);
+	accel.set_resolution(1200);
+	precision.set_ratio(40);
+	transform.set(30, false, true);
+	snap.set(true, 10);
+}
+
+motion_sample make_sample(int64_t& now, int32_t x, int32_t y)
+{
+	motion_sample s = {};
+	now += SAMPLE_US;
+	s.x		= x;
+	s.y		= y;
+	s.dt_us = SAMPLE_US;
+	s.time	= now;
+	return s;
+}
+
+void test_same_as_stages()
+{
+	pointer_pipeline pipeline;
+	pointer_stages	 direct;
+	configure_pointer(pipeline.stage<motion_scaler>(), pipeline.stage<jitter_filter>(), pipeline.stage<motion_accel>(),
+					  pipeline.stage<precision_scaler>(), pipeline.stage<motion_transform>(),
+					  pipeline.stage<angle_snap>());
+	configure_pointer(direct.scaler, direct.jitter, direct.accel, direct.precision, direct.transform, direct.snap);
+
+	// Strokes at varying speed with pauses, the precision button goes on and off in between
+	std::mt19937 rng(1);
+	int64_t		 now = 0;
+	for(int i = 0; i < 20000; i++)
+	{
+		if(i % 500 == 0)
+		{
+			bool precise = (rng() & 3) == 0;
+			pipeline.stage<precision_scaler>().set_active(precise);
+			direct.precision.set_active(precise);
+		}
+		int32_t x = 0, y = 0;
+		if((i / 300) % 4 != 3)
+		{
+			x = (int32_t) (rng() % 41) - 10;
+			y = (int32_t) (rng() % 9) - 4;
+		}
+		motion_sample a = make_sample(now, x, y);
+		motion_sample b = a;
+		pipeline.process(a);
+		direct.process(b);
+		CHECK_EQ(a.x, b.x);
+		CHECK_EQ(a.y, b.y);
+		CHECK_EQ(pipeline.pending(), direct.jitter.pending() || direct.snap.pending());
+	}
+}
+
+void test_order()
+{
+	// The stages run in the order of the template arguments: scaling Y by half before or after a
+	// quarter turn moves different axes
+	motion_pipeline<motion_scaler, motion_transform> scale_first;
+	motion_pipeline<motion_transform, motion_scaler> turn_first;
+	scale_first.stage<motion_scaler>().set_ratio(1600, 800, SENSOR_DPI);
+	scale_first.stage<motion_transform>().set(90, false, false);
+	turn_first.stage<motion_scaler>().set_ratio(1600, 800, SENSOR_DPI);
+	turn_first.stage<motion_transform>().set(90, false, false);
+
+	int64_t		  now = 0;
+	motion_sample a	  = make_sample(now, 10, 10);
+	motion_sample b	  = a;
+	scale_first.process(a);
+	turn_first.process(b);
+	CHECK_EQ(a.x, -5);
+	CHECK_EQ(a.y, 10);
+	CHECK_EQ(b.x, -10);
+	CHECK_EQ(b.y, 5);
+}
+
+void test_scroll_pipeline()
+{
+	// A scroll drag locked to Y, the scaler and the transform apply before the lock
+	scroll_pipeline p;
+	p.stage<motion_scaler>().set_ratio(800, SENSOR_DPI);
+	p.stage<motion_transform>().set(180, false, false);
+	p.stage<scroll_axis_lock>().set(true, 200);
+
+	int64_t now	  = 0;
+	int64_t out_x = 0, out_y = 0;
+	for(int i = 0; i < 100; i++)
+	{
+		motion_sample s = make_sample(now, 1, 8);
+		p.process(s);
+		out_x += s.x;
+		out_y += s.y;
+	}
+	// Only the first sample, before an axis is picked, moves across the roll
+	CHECK_EQ(out_x, -1);
+	CHECK_EQ(out_y, -400);
+}
+
+void test_pending()
+{
+	// Stages without pending() never hold the pipeline
+	motion_pipeline<motion_scaler, motion_transform> plain;
+	CHECK(!plain.pending());
+
+	motion_pipeline<motion_scaler, angle_snap> snap;
+	snap.stage<angle_snap>().set(true, 10);
+	CHECK(!snap.pending());
+
+	// A near horizontal drag holds back the motion across the axis
+	int64_t now	  = 0;
+	int64_t out_y = 0;
+	for(int i = 0; i < 20; i++)
+	{
+		motion_sample s = make_sample(now, 10, 1);
+		snap.process(s);
+		out_y += s.y;
+	}
+	CHECK(snap.pending());
+	CHECK_EQ(out_y, 1);
+
+	// The pause which ends the drag releases it
+	motion_sample s = make_sample(now, 0, 0);
+	s.time += angle_snap::IDLE_US;
+	snap.process(s);
+	CHECK_EQ(out_y + s.y, 20);
+	CHECK(!snap.pending());
+}
+
+void test_reset()
+{
+	// reset() reaches every stage: the fraction of the scaler and the motion held by the snap
+	motion_pipeline<motion_scaler, motion_transform, angle_snap> p;
+	p.stage<motion_scaler>().set_ratio(1, 3);
+	p.stage<motion_transform>().set(90, false, false);
+	p.stage<angle_snap>().set(true, 10);
+
+	// A near vertical drag after the turn, then two thirds of a count
+	int64_t now = 0;
+	for(int i = 0; i < 30; i++)
+	{
+		motion_sample s = make_sample(now, 30, 3);
+		p.process(s);
+	}
+	motion_sample s = make_sample(now, 2, 0);
+	p.process(s);
+	CHECK_EQ(p.stage<angle_snap>().axis(), angle_snap::AXIS_Y);
+	CHECK(p.pending());
+
+	p.reset();
+	CHECK(!p.pending());
+	CHECK_EQ(p.stage<angle_snap>().axis(), angle_snap::AXIS_NONE);
+
+	// Nothing is left from before to add to the next two thirds
+	s = make_sample(now, 2, 0);
+	p.process(s);
+	CHECK_EQ(s.x, 0);
+	CHECK_EQ(s.y, 0);
+	s = make_sample(now, 2, 0);
+	p.process(s);
+	CHECK_EQ(s.x, 0);
+	CHECK_EQ(s.y, 1);
+}
+
+void test_drag_ends_in_mode_switch()
+{
+	// A near horizontal drag goes straight into scrolling, as app::process_motion() switches modes:
+	// the lag of the filter and the motion held by the snap are flushed before the reset
+	motion_pipeline<motion_scaler, jitter_filter, motion_transform, angle_snap> p;
+	p.stage<jitter_filter>().set(true, 100, 70);
+	p.stage<angle_snap>().set(true, 10);
+
+	int64_t now	  = 0;
+	int64_t in_x  = 0, in_y = 0;
+	int64_t out_x = 0, out_y = 0;
+	for(int i = 0; i < 200; i++)
+	{
+		motion_sample s = make_sample(now, 12, 2);
+		in_x += s.x;
+		in_y += s.y;
+		p.process(s);
+		out_x += s.x;
+		out_y += s.y;
+	}
+	CHECK(p.pending());
+	CHECK(out_x < in_x);
+	CHECK(out_y < in_y);
+
+	motion_sample held = {};
+	held.time		   = now;
+	p.flush(held);
+	p.reset();
+	CHECK(!p.pending());
+	CHECK_EQ(out_x + held.x, in_x);
+	CHECK_EQ(out_y + held.y, in_y);
+
+	// Back to the pointer, the next drag starts from nothing
+	out_x = 0;
+	for(int i = 0; i < 50; i++)
+	{
+		motion_sample s = make_sample(now, 0, 0);
+		p.process(s);
+		out_x += s.x;
+	}
+	CHECK_EQ(out_x, 0);
+}
+
+void test_flush_without_held_motion()
+{
+	// Stages without flush() process the sample, so motion passing the pipeline is not lost
+	motion_pipeline<motion_scaler, motion_transform, angle_snap> p;
+	p.stage<motion_scaler>().set_ratio(800, SENSOR_DPI);
+	p.stage<motion_transform>().set(90, false, false);
+	p.stage<angle_snap>().set(true, 10);
+
+	int64_t		  now = 0;
+	motion_sample s	  = make_sample(now, 10, 4);
+	p.flush(s);
+	CHECK_EQ(s.x, -2);
+	CHECK_EQ(s.y, 5);
+	CHECK(!p.pending());
+}
+
+} // namespace
+
+int main()
+{
+	test_same_as_stages();
+	test_order();
+	test_scroll_pipeline();
+	test_pending();
+	test_reset();
+	test_drag_ends_in_mode_switch();
+	test_flush_without_held_motion();
+	return test_result();
+}
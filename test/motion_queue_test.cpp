@@ -0,0 +1,145 @@
+// The sensor task pushes every sample while the report task takes them in batches.
+// Whatever the report task is late by, the merged motion and sample count must match what was pushed.
+
+#include <cstdint>
+#include <thread>
+
+#include "motion_queue.h"
+#include "test_check.h"
+
+namespace
+{
+void test_empty()
+{
+	motion_queue q;
+	int32_t		 dx = 1, dy = 1;
+	uint32_t	 samples = 1;
+	CHECK(!q.pop_all(dx, dy, samples));
+	CHECK_EQ(dx, 0);
+	CHECK_EQ(dy, 0);
+	CHECK_EQ(samples, 0);
+}
+
+void test_merge()
+{
+	motion_queue q;
+	q.push(3, -1);
+	q.push(-5, 7);
+	q.push(1, 1);
+	int32_t	 dx, dy;
+	uint32_t samples;
+	CHECK(q.pop_all(dx, dy, samples));
+	CHECK_EQ(dx, -1);
+	CHECK_EQ(dy, 7);
+	CHECK_EQ(samples, 3);
+	CHECK_EQ(q.get_stats().coalesced, 3);
+	CHECK(!q.pop_all(dx, dy, samples));
+}
+
+void test_full_ring()
+{
+	// The report task stalls while a fast flick fills the ring and keeps going far beyond 16 bits
+	motion_queue   q;
+	const uint32_t overflow = 200;
+	for(uint32_t i = 0; i < motion_queue::SIZE; i++)
+	{
+		q.push(1000, -1000);
+	}
+	for(uint32_t i = 0; i < overflow; i++)
+	{
+		q.push(30000, -30000);
+	}
+	motion_queue::stats st = q.get_stats();
+	CHECK_EQ(st.pushed, motion_queue::SIZE + overflow);
+	CHECK_EQ(st.overflows, overflow);
+	CHECK_EQ(st.depth, motion_queue::SIZE);
+	CHECK_EQ(st.depth_max, motion_queue::SIZE);
+
+	int32_t	 dx, dy;
+	uint32_t samples;
+	CHECK(q.pop_all(dx, dy, samples));
+	CHECK_EQ(dx, 1000LL * motion_queue::SIZE + 30000LL * overflow);
+	CHECK_EQ(dy, -1000LL * motion_queue::SIZE - 30000LL * overflow);
+	CHECK_EQ(samples, motion_queue::SIZE + overflow);
+	CHECK_EQ(q.get_stats().depth, 0);
+
+	// Opposite motion cancelling out in the overflow still counts its samples
+	for(uint32_t i = 0; i < motion_queue::SIZE; i++)
+	{
+		q.push(0, 1);
+	}
+	q.push(5, 0);
+	q.push(-5, 0);
+	CHECK(q.pop_all(dx, dy, samples));
+	CHECK_EQ(dx, 0);
+	CHECK_EQ(dy, (int32_t) motion_queue::SIZE);
+	CHECK_EQ(samples, motion_queue::SIZE + 2);
+	CHECK(!q.pop_all(dx, dy, samples));
+}
+
+void test_concurrent()
+{
+	// The consumer runs while the producer pushes, with pauses long enough to overflow the ring
+	static motion_queue q;
+	const uint32_t		pushes = 2000000;
+	std::atomic<bool>	done{false};
+
+	std::thread producer(
+		[&done, pushes]()
+		{
+			for(uint32_t i = 0; i < pushes; i++)
+			{
+				q.push((int16_t) (i % 7) - 3 + 1000, (int16_t) (i % 5) - 2 - 1000);
+			}
+			done.store(true, std::memory_order_release);
+		});
+
+	int64_t	 x = 0, y = 0;
+	uint64_t samples = 0;
+	uint32_t pops	 = 0;
+	for(;;)
+	{
+		bool	 last = done.load(std::memory_order_acquire);
+		int32_t	 dx, dy;
+		uint32_t n;
+		if(q.pop_all(dx, dy, n))
+		{
+			x += dx;
+			y += dy;
+			samples += n;
+			pops++;
+		}
+		if(last)
+		{
+			break;
+		}
+		if(pops % 16 == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+
+	int64_t expected_x = 0, expected_y = 0;
+	for(uint32_t i = 0; i < pushes; i++)
+	{
+		expected_x += (int16_t) (i % 7) - 3 + 1000;
+		expected_y += (int16_t) (i % 5) - 2 - 1000;
+	}
+	CHECK_EQ(x, expected_x);
+	CHECK_EQ(y, expected_y);
+	CHECK_EQ(samples, pushes);
+	motion_queue::stats st = q.get_stats();
+	CHECK_EQ(st.pushed, pushes);
+	std::printf("pops %u, overflows %u, depth max %u\n", pops, st.overflows, st.depth_max);
+}
+} // namespace
+
+int main()
+{
+	test_empty();
+	test_merge();
+	test_full_ring();
+	test_concurrent();
+	return test_result();
+}
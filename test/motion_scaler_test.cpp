@@ -0,0 +1,136 @@
+// Feeds synthetic count streams through the pointer and scroll scalers the way app::process_motion()
+// does, with scroll mode and DPI switches in between, and checks that every sensor count is reported
+// once at the scale of the state it was sampled in.
+
+#include <cstdlib>
+#include <random>
+
+#include "motion_scaler.h"
+#include "test_check.h"
+
+namespace
+{
+
+const uint32_t SENSOR_DPI = 1600;
+
+struct scaled_path
+{
+	motion_scaler pointer;
+	motion_scaler scroll;
+	bool		  scrolling = false;
+
+	// Counts of the current state, sensor and output
+	int64_t in_x  = 0;
+	int64_t in_y  = 0;
+	int64_t out_x = 0;
+	int64_t out_y = 0;
+
+	void set_dpi(uint32_t dpi, uint32_t dpi_y, uint32_t scroll_dpi)
+	{
+		pointer.set_ratio(dpi, dpi_y, SENSOR_DPI);
+		scroll.set_ratio(scroll_dpi, scroll_dpi, SENSOR_DPI);
+	}
+
+	void process(int32_t dx, int32_t dy, bool scroll_mode)
+	{
+		if(scroll_mode != scrolling)
+		{
+			// The remainder of the other mode is dropped, as in app::process_motion()
+			pointer.reset();
+			scroll.reset();
+			scrolling = scroll_mode;
+			in_x = in_y = out_x = out_y = 0;
+		}
+		in_x += dx;
+		in_y += dy;
+		(scrolling ? scroll : pointer).process(dx, dy);
+		out_x += dx;
+		out_y += dy;
+	}
+};
+
+// Output expected from a count total at a constant scale, the carried fraction rounds down
+int64_t expected(int64_t counts, uint32_t dpi)
+{
+	int64_t factor = ((int64_t) dpi << motion_scaler::SHIFT) / SENSOR_DPI;
+	return (counts * factor) >> motion_scaler::SHIFT;
+}
+
+// A stroke keeps its direction, the sample sizes vary like at a changing speed
+void stroke(scaled_path& path, std::mt19937& rng, bool scroll_mode, int samples)
+{
+	int32_t sx = (rng() & 1) ? 1 : -1;
+	int32_t sy = (rng() & 1) ? 1 : -1;
+	for(int i = 0; i < samples; i++)
+	{
+		int32_t size = (int32_t) (rng() % 40);
+		path.process(sx * size, sy * (int32_t) (rng() % (size + 1)), scroll_mode);
+	}
+}
+
+void test_mode_switches()
+{
+	std::mt19937 rng(1);
+	scaled_path	 path;
+	path.set_dpi(1200, 900, 400);
+	for(int i = 0; i < 200; i++)
+	{
+		bool	 scroll_mode = (rng() % 3) == 0;
+		uint32_t dpi		 = scroll_mode ? 400 : 1200;
+		uint32_t dpi_y		 = scroll_mode ? 400 : 900;
+		stroke(path, rng, scroll_mode, 1 + (int) (rng() % 50));
+		// Nothing is lost within a state and nothing is duplicated
+		CHECK_EQ(path.out_x, expected(path.in_x, dpi));
+		CHECK_EQ(path.out_y, expected(path.in_y, dpi_y));
+	}
+}
+
+void test_dpi_switches()
+{
+	// A DPI change applies to the next sample, the fraction carried from the old scale is kept
+	std::mt19937 rng(2);
+	scaled_path	 path;
+	int64_t		 exact_x = 0; // Output units, Q16
+	int64_t		 out_x	 = 0;
+	for(int i = 0; i < 200; i++)
+	{
+		uint32_t dpi = 100 * (1 + rng() % 32);
+		path.set_dpi(dpi, dpi, dpi);
+		int64_t factor = ((int64_t) dpi << motion_scaler::SHIFT) / SENSOR_DPI;
+		for(int n = 1 + (int) (rng() % 20); n > 0; n--)
+		{
+			int32_t dx = (int32_t) (rng() % 64) - 20;
+			int64_t before = path.out_x;
+			path.process(dx, 0, false);
+			exact_x += dx * factor;
+			out_x += path.out_x - before;
+		}
+		CHECK_EQ(out_x, exact_x >> motion_scaler::SHIFT);
+	}
+}
+
+void test_unity_scale()
+{
+	// Sensor DPI equal to the target passes every count through unchanged
+	std::mt19937 rng(3);
+	scaled_path	 path;
+	path.set_dpi(SENSOR_DPI, SENSOR_DPI, SENSOR_DPI);
+	for(int i = 0; i < 1000; i++)
+	{
+		int32_t dx = (int32_t) (rng() % 200) - 100;
+		int32_t dy = (int32_t) (rng() % 200) - 100;
+		path.process(dx, dy, (i / 100) & 1);
+		CHECK_EQ(path.out_x, path.in_x);
+		CHECK_EQ(path.out_y, path.in_y);
+	}
+}
+
+} // namespace
+
+int main()
+{
+	test_mode_switches();
+	test_dpi_switches();
+	test_unity_scale();
+	return test_result();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "motion_sample.h"
+
+// A sample of a motion trace used by the host tests
+struct trace_step
+{
+	int32_t dt_ms; // Time since the previous sample
+	int32_t x;	   // Counts of the sample
+	int32_t y;
+};
+
+// Motion which went into a stage and came out of it during a replay
+struct trace_travel
+{
+	int64_t in_x, in_y, out_x, out_y;
+	int		release_tick; // Sample without motion which released held motion, 0 - none
+};
+
+// Interval of the samples without motion passed at the end of a trace
+const int64_t TRACE_TICK_US = 1000;
+
+// A stage configured with set(args...)
+template <typename Stage, typename... Args>
+Stage make_stage(Args... args)
+{
+	Stage stage;
+	stage.set(args...);
+	return stage;
+}
+
+// Replay steps [from, to) of a trace through a stage, which keeps its state between calls. With drain,
+// samples without motion follow while the stage is pending(), like the report task passes them.
+template <typename Stage, size_t N>
+trace_travel replay_trace(Stage& stage, int64_t& now, const trace_step (&trace)[N], size_t from = 0, size_t to = N,
+						  bool drain = false)
+{
+	trace_travel t = {};
+	for(size_t i = from; i < to; i++)
+	{
+		motion_sample s = {};
+		now += trace[i].dt_ms * 1000;
+		s.x	   = trace[i].x;
+		s.y	   = trace[i].y;
+		s.time = now;
+		t.in_x += s.x;
+		t.in_y += s.y;
+		stage.process(s);
+		t.out_x += s.x;
+		t.out_y += s.y;
+	}
+	if constexpr(requires { stage.pending(); })
+	{
+		for(int tick = 1; drain && stage.pending() && tick < 10000; tick++)
+		{
+			motion_sample s = {};
+			now += TRACE_TICK_US;
+			s.dt_us = TRACE_TICK_US;
+			s.time	= now;
+			stage.process(s);
+			if(s.x != 0 || s.y != 0)
+			{
+				t.release_tick = tick;
+			}
+			t.out_x += s.x;
+			t.out_y += s.y;
+		}
+	}
+	return t;
+}
@@ -0,0 +1,134 @@
+// Rotation and mirroring of the sensor motion into the host frame. The right angles are exact,
+// other angles carry the rounded fraction, so the total stays on the rotated travel of the ball.
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+#include "motion_transform.h"
+#include "test_check.h"
+
+namespace
+{
+
+struct vec
+{
+	int32_t x;
+	int32_t y;
+};
+
+vec transform(motion_transform& t, int32_t x, int32_t y)
+{
+	t.process(x, y);
+	return {x, y};
+}
+
+motion_transform make_transform(int rotation, bool flip_x, bool flip_y)
+{
+	motion_transform t;
+	t.set(rotation, flip_x, flip_y);
+	return t;
+}
+
+void check_vec(vec v, int32_t x, int32_t y)
+{
+	CHECK_EQ(v.x, x);
+	CHECK_EQ(v.y, y);
+}
+
+void test_right_angles()
+{
+	// Counterclockwise in the host frame, y grows downwards
+	motion_transform t = make_transform(0, false, false);
+	check_vec(transform(t, 3, -5), 3, -5);
+	t = make_transform(90, false, false);
+	check_vec(transform(t, 3, -5), 5, 3);
+	t = make_transform(180, false, false);
+	check_vec(transform(t, 3, -5), -3, 5);
+	t = make_transform(270, false, false);
+	check_vec(transform(t, 3, -5), -5, -3);
+
+	// Angles outside of a turn wrap around
+	t = make_transform(-90, false, false);
+	check_vec(transform(t, 3, -5), -5, -3);
+	t = make_transform(450, false, false);
+	check_vec(transform(t, 3, -5), 5, 3);
+}
+
+void test_flips()
+{
+	// The mirror applies after the rotation
+	motion_transform t = make_transform(0, true, false);
+	check_vec(transform(t, 3, -5), -3, -5);
+	t = make_transform(0, false, true);
+	check_vec(transform(t, 3, -5), 3, 5);
+	t = make_transform(90, true, false);
+	check_vec(transform(t, 3, -5), -5, 3);
+	t = make_transform(270, true, true);
+	check_vec(transform(t, 3, -5), 5, 3);
+}
+
+void test_large_motion()
+{
+	// Merged motion may exceed 16 bits, the products are taken in 64 bits
+	motion_transform t = make_transform(90, false, false);
+	check_vec(transform(t, 1 << 20, -(1 << 22)), 1 << 22, 1 << 20);
+	t = make_transform(180, true, false);
+	check_vec(transform(t, INT32_MAX / 2, 7), INT32_MAX / 2, -7);
+}
+
+void test_arbitrary_angle()
+{
+	// Small samples at 30 degrees, each output is rounded but the fraction is carried
+	std::mt19937	 rng(1);
+	motion_transform t	  = make_transform(30, false, false);
+	double			 rad  = 30 * M_PI / 180.0;
+	int64_t			 in_x = 0, in_y = 0, out_x = 0, out_y = 0;
+	for(int i = 0; i < 20000; i++)
+	{
+		int32_t x = (int32_t) (rng() % 7) - 3;
+		int32_t y = (int32_t) (rng() % 5) - 1;
+		in_x += x;
+		in_y += y;
+		vec v = transform(t, x, y);
+		out_x += v.x;
+		out_y += v.y;
+		if(i % 1000 == 999)
+		{
+			double exact_x = in_x * cos(rad) - in_y * sin(rad);
+			double exact_y = in_x * sin(rad) + in_y * cos(rad);
+			CHECK(std::abs(out_x - exact_x) < 2);
+			CHECK(std::abs(out_y - exact_y) < 2);
+		}
+	}
+}
+
+void test_reset()
+{
+	// One count at 45 degrees is 0.7 on each axis, the second count crosses a whole one
+	motion_transform t = make_transform(45, false, false);
+	check_vec(transform(t, 1, 0), 0, 0);
+	check_vec(transform(t, 1, 0), 1, 1);
+
+	t.reset();
+	check_vec(transform(t, 1, 0), 0, 0);
+	t.reset();
+	check_vec(transform(t, 1, 0), 0, 0);
+
+	// set() starts from no fraction as well
+	transform(t, 1, 0);
+	t.set(45, false, false);
+	check_vec(transform(t, 1, 0), 0, 0);
+}
+
+} // namespace
+
+int main()
+{
+	test_right_angles();
+	test_flips();
+	test_large_motion();
+	test_arbitrary_angle();
+	test_reset();
+	return test_result();
+}
@@ -0,0 +1,376 @@
+// Replays the PAW3395 register tables against a register file emulator and compares the
+// result with the hand written sequences the tables replaced.
+
+#include <cstring>
+#include <vector>
+
+#include "paw3395_tables.h"
+#include "test_check.h"
+
+namespace
+{
+
+// Banked register file, register 0x7F selects the bank like on the sensor
+struct paw3395_emulator
+{
+	struct write
+	{
+		uint8_t bank;
+		uint8_t reg;
+		uint8_t value;
+	};
+
+	uint8_t			   bank = 0;
+	uint8_t			   regs[256][128];
+	bool			   written[256][128];
+	std::vector<write> writes; // Register writes in order, bank selects excluded
+
+	paw3395_emulator()
+	{
+		memset(regs, 0, sizeof(regs));
+		memset(written, 0, sizeof(written));
+	}
+
+	void write_register(uint8_t reg, uint8_t value)
+	{
+		if(reg == 0x7F)
+		{
+			bank = value;
+			return;
+		}
+		regs[bank][reg]	   = value;
+		written[bank][reg] = true;
+		writes.push_back({bank, reg, value});
+	}
+
+	void write_table(const paw3395_reg_table& table)
+	{
+		paw3395_write_table(table, [this](uint8_t reg, uint8_t value) { write_register(reg, value); });
+	}
+
+	template <size_t N>
+	void write_sequence(const uint8_t (&seq)[N][2])
+	{
+		for(size_t i = 0; i < N; i++)
+		{
+			write_register(seq[i][0], seq[i][1]);
+		}
+	}
+};
+
+// Sequences written by the sensor driver before the register tables, copied verbatim
+const uint8_t BASELINE_INIT[][2] = {
+	{0x7F, 0x07},
+	{0x40, 0x41},
+	{0x7F, 0x00},
+	{0x40, 0x80},
+	{0x7F, 0x0E},
+	{0x55, 0x0D},
+	{0x56, 0x1B},
+	{0x57, 0xE8},
+	{0x58, 0xD5},
+	{0x7F, 0x14},
+	{0x42, 0xBC},
+	{0x43, 0x74},
+	{0x4B, 0x20},
+	{0x4D, 0x00},
+	{0x53, 0x0E},
+	{0x7F, 0x05},
+	{0x44, 0x04},
+	{0x4D, 0x06},
+	{0x51, 0x40},
+	{0x53, 0x40},
+	{0x55, 0xCA},
+	{0x5A, 0xE8},
+	{0x5B, 0xEA},
+	{0x61, 0x31},
+	{0x62, 0x64},
+	{0x6D, 0xB8},
+	{0x6E, 0x0F},
+	{0x70, 0x02},
+	{0x4A, 0x2A},
+	{0x60, 0x26},
+	{0x7F, 0x06},
+	{0x6D, 0x70},
+	{0x6E, 0x60},
+	{0x6F, 0x04},
+	{0x53, 0x02},
+	{0x55, 0x11},
+	{0x7A, 0x01},
+	{0x7D, 0x51},
+	{0x7F, 0x07},
+	{0x41, 0x10},
+	{0x42, 0x32},
+	{0x43, 0x00},
+	{0x7F, 0x08},
+	{0x71, 0x4F},
+	{0x7F, 0x09},
+	{0x62, 0x1F},
+	{0x63, 0x1F},
+	{0x65, 0x03},
+	{0x66, 0x03},
+	{0x67, 0x1F},
+	{0x68, 0x1F},
+	{0x69, 0x03},
+	{0x6A, 0x03},
+	{0x6C, 0x1F},
+	{0x6D, 0x1F},
+	{0x51, 0x04},
+	{0x53, 0x20},
+	{0x54, 0x20},
+	{0x71, 0x0C},
+	{0x72, 0x07},
+	{0x73, 0x07},
+	{0x7F, 0x0A},
+	{0x4A, 0x14},
+	{0x4C, 0x14},
+	{0x55, 0x19},
+	{0x7F, 0x14},
+	{0x4B, 0x30},
+	{0x4C, 0x03},
+	{0x61, 0x0B},
+	{0x62, 0x0A},
+	{0x63, 0x02},
+	{0x7F, 0x15},
+	{0x4C, 0x02},
+	{0x56, 0x02},
+	{0x41, 0x91},
+	{0x4D, 0x0A},
+	{0x7F, 0x0C},
+	{0x4A, 0x10},
+	{0x4B, 0x0C},
+	{0x4C, 0x40},
+	{0x41, 0x25},
+	{0x55, 0x18},
+	{0x56, 0x14},
+	{0x49, 0x0A},
+	{0x42, 0x00},
+	{0x43, 0x2D},
+	{0x44, 0x0C},
+	{0x54, 0x1A},
+	{0x5A, 0x0D},
+	{0x5F, 0x1E},
+	{0x5B, 0x05},
+	{0x5E, 0x0F},
+	{0x7F, 0x0D},
+	{0x48, 0xDD},
+	{0x4F, 0x03},
+	{0x52, 0x49},
+	{0x51, 0x00},
+	{0x54, 0x5B},
+	{0x53, 0x00},
+	{0x56, 0x64},
+	{0x55, 0x00},
+	{0x58, 0xA5},
+	{0x57, 0x02},
+	{0x5A, 0x29},
+	{0x5B, 0x47},
+	{0x5C, 0x81},
+	{0x5D, 0x40},
+	{0x71, 0xDC},
+	{0x70, 0x07},
+	{0x73, 0x00},
+	{0x72, 0x08},
+	{0x75, 0xDC},
+	{0x74, 0x07},
+	{0x77, 0x00},
+	{0x76, 0x08},
+	{0x7F, 0x10},
+	{0x4C, 0xD0},
+	{0x7F, 0x00},
+	{0x4F, 0x63},
+	{0x4E, 0x00},
+	{0x52, 0x63},
+	{0x51, 0x00},
+	{0x54, 0x54},
+	{0x5A, 0x10},
+	{0x77, 0x4F},
+	{0x47, 0x01},
+	{0x5B, 0x40},
+	{0x64, 0x60},
+	{0x65, 0x06},
+	{0x66, 0x13},
+	{0x67, 0x0F},
+	{0x78, 0x01},
+	{0x79, 0x9C},
+	{0x40, 0x00},
+	{0x55, 0x02},
+	{0x23, 0x70},
+	{0x22, 0x01},
+};
+
+const uint8_t BASELINE_INIT_FALLBACK[][2] = {
+	{0x7F, 0x14},
+	{0x6C, 0x00},
+	{0x7F, 0x00},
+};
+
+const uint8_t BASELINE_INIT_FINISH[][2] = {
+	{0x22, 0x00},
+	{0x55, 0x00},
+	{0x7F, 0x07},
+	{0x40, 0x40},
+	{0x7F, 0x00},
+};
+
+const uint8_t BASELINE_HIGH_PERFORMANCE[][2] = {
+	{0x7F, 0x05},
+	{0x51, 0x40},
+	{0x53, 0x40},
+	{0x61, 0x31},
+	{0x6E, 0x0F},
+	{0x7F, 0x07},
+	{0x42, 0x32},
+	{0x43, 0x00},
+	{0x7F, 0x0D},
+	{0x51, 0x00},
+	{0x52, 0x49},
+	{0x53, 0x00},
+	{0x54, 0x5B},
+	{0x55, 0x00},
+	{0x56, 0x64},
+	{0x57, 0x02},
+	{0x58, 0xA5},
+	{0x7F, 0x00},
+	{0x54, 0x54},
+	{0x78, 0x01},
+	{0x79, 0x9C},
+};
+
+const uint8_t BASELINE_LOW_POWER[][2] = {
+	{0x7F, 0x05},
+	{0x51, 0x40},
+	{0x53, 0x40},
+	{0x61, 0x3B},
+	{0x6E, 0x1F},
+	{0x7F, 0x07},
+	{0x42, 0x32},
+	{0x43, 0x00},
+	{0x7F, 0x0D},
+	{0x51, 0x00},
+	{0x52, 0x49},
+	{0x53, 0x00},
+	{0x54, 0x5B},
+	{0x55, 0x00},
+	{0x56, 0x64},
+	{0x57, 0x02},
+	{0x58, 0xA5},
+	{0x7F, 0x00},
+	{0x54, 0x54},
+	{0x78, 0x01},
+	{0x79, 0x9C},
+};
+
+const uint8_t BASELINE_OFFICE[][2] = {
+	{0x7F, 0x05},
+	{0x51, 0x28},
+	{0x53, 0x30},
+	{0x61, 0x3B},
+	{0x6E, 0x1F},
+	{0x7F, 0x07},
+	{0x42, 0x32},
+	{0x43, 0x00},
+	{0x7F, 0x0D},
+	{0x51, 0x00},
+	{0x52, 0x49},
+	{0x53, 0x00},
+	{0x54, 0x5B},
+	{0x55, 0x00},
+	{0x56, 0x64},
+	{0x57, 0x02},
+	{0x58, 0xA5},
+	{0x7F, 0x00},
+	{0x54, 0x52},
+	{0x78, 0x0A},
+	{0x79, 0x0F},
+};
+
+const uint8_t BASELINE_GAMING[][2] = {
+	{0x7F, 0x05},
+	{0x51, 0x40},
+	{0x53, 0x40},
+	{0x61, 0x31},
+	{0x6E, 0x0F},
+	{0x7F, 0x07},
+	{0x42, 0x2F},
+	{0x43, 0x00},
+	{0x7F, 0x0D},
+	{0x51, 0x12},
+	{0x52, 0xDB},
+	{0x53, 0x12},
+	{0x54, 0xDC},
+	{0x55, 0x12},
+	{0x56, 0xEA},
+	{0x57, 0x15},
+	{0x58, 0x2D},
+	{0x7F, 0x00},
+	{0x54, 0x55},
+	{0x40, 0x83},
+};
+
+void check_same(const paw3395_emulator& table, const paw3395_emulator& baseline, const char* name)
+{
+	std::printf("%s: %zu writes\n", name, table.writes.size());
+	CHECK_EQ(table.bank, 0);
+	CHECK_EQ(table.bank, baseline.bank);
+	CHECK_EQ(table.writes.size(), baseline.writes.size());
+	for(size_t i = 0; i < table.writes.size() && i < baseline.writes.size(); i++)
+	{
+		const auto& t = table.writes[i];
+		const auto& b = baseline.writes[i];
+		if(t.bank != b.bank || t.reg != b.reg || t.value != b.value)
+		{
+			std::printf("%s: write %zu is %02X:%02X=%02X, expected %02X:%02X=%02X\n", name, i, t.bank, t.reg, t.value,
+						b.bank, b.reg, b.value);
+			g_test_failures++;
+			return;
+		}
+	}
+	CHECK(memcmp(table.regs, baseline.regs, sizeof(table.regs)) == 0);
+	CHECK(memcmp(table.written, baseline.written, sizeof(table.written)) == 0);
+}
+
+void test_init(bool fallback)
+{
+	paw3395_emulator table, baseline;
+	table.write_table(paw3395_make_table(PAW3395_INIT_REGS));
+	baseline.write_sequence(BASELINE_INIT);
+	if(fallback)
+	{
+		table.write_table(paw3395_make_table(PAW3395_INIT_FALLBACK_REGS));
+		baseline.write_sequence(BASELINE_INIT_FALLBACK);
+	}
+	table.write_table(paw3395_make_table(PAW3395_INIT_FINISH_REGS));
+	baseline.write_sequence(BASELINE_INIT_FINISH);
+	check_same(table, baseline, fallback ? "init with fallback" : "init");
+}
+
+template <size_t N>
+void test_mode(uint8_t mode, const uint8_t (&seq)[N][2], const char* name)
+{
+	// The modes are switched on an initialized sensor, left in any bank
+	paw3395_emulator table, baseline;
+	for(auto* emu : {&table, &baseline})
+	{
+		emu->write_table(paw3395_make_table(PAW3395_INIT_REGS));
+		emu->write_table(paw3395_make_table(PAW3395_INIT_FINISH_REGS));
+		emu->write_register(0x7F, 0x0D);
+		emu->writes.clear();
+	}
+	table.write_table(PAW3395_MODES[mode]);
+	baseline.write_sequence(seq);
+	check_same(table, baseline, name);
+}
+
+} // namespace
+
+int main()
+{
+	test_init(false);
+	test_init(true);
+	test_mode(0, BASELINE_HIGH_PERFORMANCE, "high performance");
+	test_mode(1, BASELINE_LOW_POWER, "low power");
+	test_mode(2, BASELINE_OFFICE, "office");
+	test_mode(3, BASELINE_GAMING, "gaming");
+	return test_result();
+}
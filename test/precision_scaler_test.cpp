@@ -0,0 +1,55 @@
+// The precision mode scales the pointer by the motion_scaler inside precision_scaler: slow motion is
+// carried over samples, and toggling the mode starts from a clean fraction.
+
+#include "precision_scaler.h"
+#include "test_check.h"
+
+namespace
+{
+
+int64_t move(precision_scaler& scaler, int samples, int32_t dx)
+{
+	int64_t out = 0;
+	for(int i = 0; i < samples; i++)
+	{
+		motion_sample s = {};
+		s.x				= dx;
+		scaler.process(s);
+		out += s.x;
+	}
+	return out;
+}
+
+void test_slow_motion_is_carried()
+{
+	precision_scaler scaler;
+	scaler.set_ratio(25);
+	scaler.set_active(true);
+	// One count per sample still moves the pointer every fourth sample, in both directions
+	CHECK_EQ(move(scaler, 400, 1), 100);
+	CHECK_EQ(move(scaler, 400, -1), -100);
+}
+
+void test_toggle()
+{
+	precision_scaler scaler;
+	scaler.set_ratio(50);
+	CHECK_EQ(move(scaler, 10, 3), 30);
+	scaler.set_active(true);
+	CHECK_EQ(move(scaler, 9, 3), 13);
+	scaler.set_active(false);
+	CHECK_EQ(move(scaler, 10, 3), 30);
+	// The half count left from the previous activation is dropped
+	scaler.set_active(true);
+	CHECK_EQ(move(scaler, 1, 1), 0);
+	CHECK_EQ(move(scaler, 1, 1), 1);
+}
+
+} // namespace
+
+int main()
+{
+	test_slow_motion_is_carried();
+	test_toggle();
+	return test_result();
+}
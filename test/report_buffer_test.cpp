@@ -0,0 +1,139 @@
+// Several tasks publish mouse reports while the NimBLE host reads them.
+// Every report read must be one of the published reports, never bytes of two writers mixed.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "report_buffer.h"
+#include "test_check.h"
+
+namespace
+{
+const int		WRITERS			  = 3;
+const int		READERS			  = 2;
+const uint32_t	WRITES_PER_WRITER = 200000;
+const size_t	REPORT_SIZE		  = REPORT_BUFFER_MAX;
+
+// byte 0: writer, bytes 1 - 4: report number of the writer, the rest depends on both
+void make_report(uint8_t* report, uint8_t writer, uint32_t n)
+{
+	report[0] = writer;
+	for(int i = 0; i < 4; ++i)
+	{
+		report[1 + i] = static_cast<uint8_t>(n >> (i * 8));
+	}
+	for(size_t i = 5; i < REPORT_SIZE; ++i)
+	{
+		report[i] = static_cast<uint8_t>(n * 31 + writer * 97 + i * 13);
+	}
+}
+
+struct reader_result
+{
+	uint64_t reads	 = 0;
+	uint64_t retries = 0;
+	uint64_t torn	 = 0; // reports which were never published
+	uint64_t stale	 = 0; // a report older than one read before from the same writer
+};
+
+void read_reports(report_buffer* rb, const std::atomic<bool>* done, reader_result* result)
+{
+	uint32_t last[WRITERS + 1] = {};
+	bool	 seen[WRITERS + 1] = {};
+	while(!done->load(std::memory_order_acquire))
+	{
+		uint8_t report[REPORT_SIZE];
+		result->retries += report_buffer_read(rb, report, REPORT_SIZE);
+		result->reads++;
+
+		uint8_t	 writer = report[0];
+		uint32_t n		= 0;
+		for(int i = 0; i < 4; ++i)
+		{
+			n |= static_cast<uint32_t>(report[1 + i]) << (i * 8);
+		}
+		uint8_t expected[REPORT_SIZE];
+		make_report(expected, writer, n);
+		if(writer > WRITERS || std::memcmp(report, expected, REPORT_SIZE) != 0)
+		{
+			result->torn++;
+			continue;
+		}
+		if(seen[writer] && n < last[writer])
+		{
+			result->stale++;
+		}
+		seen[writer] = true;
+		last[writer] = n;
+	}
+}
+
+void test_concurrent_writers()
+{
+	static report_buffer rb = REPORT_BUFFER_INIT(0);
+
+	// The host reads the initial report of writer 0 until the tasks start publishing
+	uint8_t report[REPORT_SIZE];
+	make_report(report, 0, 0);
+	report_buffer_write(&rb, report, REPORT_SIZE);
+
+	std::atomic<bool>		   done{false};
+	std::vector<reader_result> results(READERS);
+	std::vector<std::thread>   readers;
+	for(int i = 0; i < READERS; ++i)
+	{
+		readers.emplace_back(read_reports, &rb, &done, &results[i]);
+	}
+
+	std::vector<std::thread> writers;
+	for(int w = 1; w <= WRITERS; ++w)
+	{
+		writers.emplace_back(
+			[w]()
+			{
+				uint8_t data[REPORT_SIZE];
+				for(uint32_t n = 1; n <= WRITES_PER_WRITER; ++n)
+				{
+					make_report(data, static_cast<uint8_t>(w), n);
+					report_buffer_write(&rb, data, REPORT_SIZE);
+				}
+			});
+	}
+	for(auto& t : writers)
+	{
+		t.join();
+	}
+	done.store(true, std::memory_order_release);
+	for(auto& t : readers)
+	{
+		t.join();
+	}
+
+	// No publication was lost, each one advanced seq once
+	CHECK_EQ(rb.seq, 1 + WRITERS * WRITES_PER_WRITER);
+
+	uint64_t retries = 0;
+	for(const auto& r : results)
+	{
+		CHECK(r.reads > 0);
+		CHECK_EQ(r.torn, 0);
+		CHECK_EQ(r.stale, 0);
+		retries += r.retries;
+	}
+	std::printf("reads %llu, %llu, torn reads retried %llu\n", (unsigned long long) results[0].reads,
+				(unsigned long long) results[1].reads, (unsigned long long) retries);
+
+	// The last report published is the current one
+	report_buffer_read(&rb, report, REPORT_SIZE);
+	CHECK_EQ(report[1] | report[2] << 8 | report[3] << 16 | report[4] << 24, WRITES_PER_WRITER);
+}
+} // namespace
+
+int main()
+{
+	test_concurrent_writers();
+	return test_result();
+}
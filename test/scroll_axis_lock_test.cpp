@@ -0,0 +1,150 @@
+// Checks scroll_axis_lock on traces of rolls: the minor axis of a roll is suppressed, a clear change
+// of direction or a pause moves the lock, and rolls without a dominant axis pass unchanged.
+
+#include <cstdlib>
+
+#include "motion_trace.h"
+#include "scroll_axis_lock.h"
+#include "test_check.h"
+
+namespace
+{
+
+// Downward roll, the thumb pushes the ball slightly sideways
+const trace_step VERTICAL_ROLL[] = {
+	{8, 0, -3}, {8, 1, -3}, {8, 1, -3}, {8, 1, -3}, {8, 1, -6}, {8, 2, -5},
+	{8, 0, -7}, {8, 0, -5}, {8, 0, -7}, {8, 0, -8}, {8, 0, -9}, {8, 1, -8},
+	{8, -1, -8}, {8, 1, -9}, {8, -1, -9}, {8, 1, -11}, {8, 2, -10}, {8, 1, -11},
+	{8, 1, -13}, {8, 2, -12}, {8, 0, -13}, {8, 0, -13}, {8, 1, -13}, {8, 0, -14},
+	{8, 1, -15}, {8, 2, -13}, {8, 1, -13}, {8, 1, -12}, {8, 0, -11}, {8, -1, -13},
+	{8, 0, -10}, {8, 1, -10}, {8, 0, -10}, {8, 0, -10}, {8, 1, -8}, {8, 0, -10},
+	{8, 1, -9}, {8, -1, -8}, {8, 1, -6}, {8, 1, -8}, {8, -1, -6}, {8, 1, -5},
+	{8, 1, -6}, {8, -1, -4}, {8, 2, -3}, {8, 1, -4}, {8, -1, -4}, {8, -1, -4},
+};
+
+// Roll to the right with a vertical wobble
+const trace_step HORIZONTAL_ROLL[] = {
+	{8, 4, 0}, {8, 4, 0}, {8, 4, 1}, {8, 5, -2}, {8, 4, 0}, {8, 4, -2},
+	{8, 7, -2}, {8, 5, -2}, {8, 7, -2}, {8, 6, -2}, {8, 8, -1}, {8, 9, 0},
+	{8, 8, -1}, {8, 10, -2}, {8, 9, 1}, {8, 9, -2}, {8, 10, -1}, {8, 11, 0},
+	{8, 12, -2}, {8, 12, 0}, {8, 13, 0}, {8, 12, 0}, {8, 10, -2}, {8, 10, -1},
+	{8, 10, 0}, {8, 11, 0}, {8, 8, -1}, {8, 8, 0}, {8, 9, -2}, {8, 8, -2},
+	{8, 7, 0}, {8, 6, 0}, {8, 5, -1}, {8, 5, 0}, {8, 5, 1}, {8, 4, 0},
+	{8, 3, 0}, {8, 5, 0}, {8, 2, 0}, {8, 2, 0},
+};
+
+// Upward roll turning into a roll to the right without a pause
+const trace_step VERTICAL_THEN_HORIZONTAL[] = {
+	{8, -1, 11}, {8, 0, 10}, {8, -1, 8}, {8, 0, 11}, {8, -1, 11}, {8, -1, 11},
+	{8, 1, 9}, {8, 0, 8}, {8, 1, 8}, {8, 1, 10}, {8, -1, 11}, {8, -1, 11},
+	{8, 1, 8}, {8, 1, 10}, {8, 1, 9}, {8, -1, 10}, {8, 0, 10}, {8, 0, 8},
+	{8, -1, 9}, {8, 0, 9}, {8, 1, 8}, {8, 1, 8}, {8, -1, 10}, {8, 0, 9},
+	{8, -1, 10}, {8, 1, 8}, {8, 0, 8}, {8, -1, 9}, {8, -1, 10}, {8, 1, 8},
+	{8, 0, 8}, {8, 4, 6}, {8, 7, 4}, {8, 10, 2}, {8, 12, 0}, {8, 16, 0},
+	{8, 13, -1}, {8, 13, -1}, {8, 12, 0}, {8, 14, 1}, {8, 12, -1}, {8, 12, -1},
+	{8, 12, 1}, {8, 13, 0}, {8, 13, 1}, {8, 15, -1}, {8, 13, -1}, {8, 15, -1},
+	{8, 12, 1}, {8, 13, -1}, {8, 13, -1}, {8, 15, -1}, {8, 14, -1}, {8, 15, 0},
+	{8, 14, -1}, {8, 15, 1}, {8, 13, 0}, {8, 15, 0}, {8, 15, -1}, {8, 14, -1},
+	{8, 12, -1}, {8, 15, 0}, {8, 12, 1}, {8, 13, 0}, {8, 14, -1}, {8, 15, 0},
+};
+
+// Upward roll, a pause, then a roll to the left
+const trace_step VERTICAL_PAUSE_HORIZONTAL[] = {
+	{8, 0, 11}, {8, 0, 10}, {8, 0, 10}, {8, 0, 10}, {8, 0, 10}, {8, 0, 10},
+	{8, 1, 11}, {8, 0, 9}, {8, 0, 9}, {8, 0, 11}, {8, 1, 11}, {8, 1, 9},
+	{8, 0, 9}, {8, 0, 9}, {8, 1, 11}, {8, 0, 11}, {8, 1, 10}, {8, 0, 11},
+	{8, 1, 10}, {8, 1, 11}, {400, -9, 0}, {8, -11, 0}, {8, -10, 1},
+	{8, -10, 1}, {8, -11, 1}, {8, -9, 1}, {8, -10, 1}, {8, -11, 1}, {8, -9, 0},
+	{8, -9, 1}, {8, -10, 1}, {8, -10, 1}, {8, -9, 1}, {8, -9, 1}, {8, -11, 0},
+	{8, -11, 0}, {8, -9, 1}, {8, -9, 0}, {8, -10, 1}, {8, -11, 0},
+};
+
+// Diagonal roll, no axis leads by the default ratio
+const trace_step DIAGONAL_ROLL[] = {
+	{8, 7, -8}, {8, 7, -7}, {8, 8, -9}, {8, 8, -8}, {8, 7, -7}, {8, 7, -7},
+	{8, 7, -7}, {8, 7, -9}, {8, 6, -6}, {8, 7, -9}, {8, 7, -6}, {8, 8, -9},
+	{8, 10, -9}, {8, 8, -8}, {8, 7, -8}, {8, 8, -8}, {8, 7, -6}, {8, 7, -9},
+	{8, 7, -7}, {8, 8, -7}, {8, 7, -6}, {8, 8, -8}, {8, 8, -9}, {8, 7, -8},
+	{8, 7, -7}, {8, 7, -8}, {8, 10, -9}, {8, 7, -7}, {8, 8, -8}, {8, 5, -7},
+};
+
+void test_vertical_roll()
+{
+	auto		 lock = make_stage<scroll_axis_lock>(true, 200);
+	int64_t		 now  = 1000000;
+	trace_travel t	  = replay_trace(lock, now, VERTICAL_ROLL);
+	// Pans get through only until the roll travels MIN_TRAVEL, within the first samples
+	CHECK(std::abs(t.out_x) <= 2);
+	CHECK_EQ(t.out_y, t.in_y);
+	CHECK_EQ(lock.axis(), scroll_axis_lock::AXIS_Y);
+}
+
+void test_horizontal_roll()
+{
+	auto		 lock = make_stage<scroll_axis_lock>(true, 200);
+	int64_t		 now  = 1000000;
+	trace_travel t	  = replay_trace(lock, now, HORIZONTAL_ROLL);
+	CHECK(std::abs(t.out_y) <= 2);
+	CHECK_EQ(t.out_x, t.in_x);
+}
+
+void test_change_of_direction()
+{
+	// The lock holds through the turn and moves early in the new roll
+	auto		 lock  = make_stage<scroll_axis_lock>(true, 200);
+	int64_t		 now   = 1000000;
+	trace_travel roll  = replay_trace(lock, now, VERTICAL_THEN_HORIZONTAL, 0, 30);
+	trace_travel turn  = replay_trace(lock, now, VERTICAL_THEN_HORIZONTAL, 30, 40);
+	trace_travel after = replay_trace(lock, now, VERTICAL_THEN_HORIZONTAL, 40, 66);
+	CHECK_EQ(roll.out_x, 0);
+	CHECK_EQ(roll.out_y, roll.in_y);
+	CHECK(turn.out_x < turn.in_x);
+	CHECK_EQ(after.out_y, 0);
+	CHECK_EQ(after.out_x, after.in_x);
+	CHECK_EQ(lock.axis(), scroll_axis_lock::AXIS_X);
+}
+
+void test_pause_releases_lock()
+{
+	// The roll after the pause picks its axis from its first sample
+	auto		 lock = make_stage<scroll_axis_lock>(true, 200);
+	int64_t		 now  = 1000000;
+	trace_travel up	  = replay_trace(lock, now, VERTICAL_PAUSE_HORIZONTAL, 0, 20);
+	trace_travel left = replay_trace(lock, now, VERTICAL_PAUSE_HORIZONTAL, 20, 40);
+	CHECK_EQ(up.out_x, 0);
+	CHECK_EQ(left.out_x, left.in_x);
+	CHECK(left.in_x < 0);
+	CHECK(std::abs(left.out_y) <= 1);
+}
+
+void test_diagonal_roll()
+{
+	auto		 lock = make_stage<scroll_axis_lock>(true, 200);
+	int64_t		 now  = 1000000;
+	trace_travel t	  = replay_trace(lock, now, DIAGONAL_ROLL);
+	CHECK_EQ(lock.axis(), scroll_axis_lock::AXIS_NONE);
+	CHECK_EQ(t.out_x, t.in_x);
+	CHECK_EQ(t.out_y, t.in_y);
+}
+
+void test_disabled()
+{
+	auto		 lock = make_stage<scroll_axis_lock>(false, 200);
+	int64_t		 now  = 1000000;
+	trace_travel t	  = replay_trace(lock, now, VERTICAL_ROLL);
+	CHECK_EQ(t.out_x, t.in_x);
+	CHECK_EQ(t.out_y, t.in_y);
+}
+
+} // namespace
+
+int main()
+{
+	test_vertical_roll();
+	test_horizontal_roll();
+	test_change_of_direction();
+	test_pause_releases_lock();
+	test_diagonal_roll();
+	test_disabled();
+	return test_result();
+}
@@ -0,0 +1,146 @@
+// Scroll distance against ball travel: roll traces are replayed through scroll_converter and the
+// reported wheel and AC pan are compared with the travel, in high and low resolution mode.
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "motion_trace.h"
+#include "scroll_converter.h"
+#include "test_check.h"
+
+namespace
+{
+// Slow roll, reversal, steady roll, fast flick beyond the 16 bit report fields, creep back
+const trace_step ROLL[] = {{1, 0, 1}, {1, 1, -3}, {1, -1, 7}, {1, 3, 2500}, {1, 0, -1}};
+const uint32_t	 ROLL_REPEAT[] = {1000, 250, 300, 40, 77};
+
+struct scroll_result
+{
+	int64_t travel_x = 0;
+	int64_t travel_y = 0;
+	int64_t wheel	 = 0;
+	int64_t ac_pan	 = 0;
+};
+
+scroll_result replay_roll(scroll_converter& conv)
+{
+	scroll_result r;
+	for(size_t i = 0; i < sizeof(ROLL) / sizeof(ROLL[0]); i++)
+	{
+		for(uint32_t n = 0; n < ROLL_REPEAT[i]; n++)
+		{
+			motion_sample s = {};
+			s.x				= ROLL[i].x;
+			s.y				= ROLL[i].y;
+			r.travel_x += s.x;
+			r.travel_y += s.y;
+			conv.process(s);
+			CHECK_EQ(s.x, 0);
+			CHECK_EQ(s.y, 0);
+			r.wheel += s.wheel;
+			r.ac_pan += s.ac_pan;
+		}
+	}
+	return r;
+}
+
+// What is still in the remainder, in units: below one unit in high resolution, one detent in low
+void check_error(int64_t reported, int64_t travel, uint32_t sensitivity, uint32_t multiplier, bool high_res)
+{
+	// travel / sensitivity detents of multiplier units each, compared in units * sensitivity
+	int64_t error = travel * multiplier - reported * sensitivity;
+	int64_t limit = high_res ? sensitivity : (int64_t) sensitivity * multiplier;
+	CHECK(std::llabs(error) < limit);
+}
+
+void test_roll_trace()
+{
+	const bool modes[] = {true, false};
+	for(bool high_res : modes)
+	{
+		uint8_t			 multiplier = 120;
+		scroll_converter conv;
+		conv.set(100, true, true, high_res, &multiplier);
+		scroll_result r = replay_roll(conv);
+		check_error(r.wheel, r.travel_y, 100, multiplier, high_res);
+		check_error(r.ac_pan, r.travel_x, 100, multiplier, high_res);
+		std::printf("%s resolution: travel %.2f detents, wheel %.2f detents\n", high_res ? "high" : "low",
+					r.travel_y / 100.0, (double) r.wheel / multiplier);
+	}
+}
+
+void test_all_settings()
+{
+	// Every sensitivity and multiplier the host and the configuration can choose
+	const bool modes[] = {true, false};
+	for(bool high_res : modes)
+	{
+		for(uint32_t sensitivity = 1; sensitivity <= 255; sensitivity += 7)
+		{
+			for(uint32_t mult = 1; mult <= 127; mult += 9)
+			{
+				uint8_t			 multiplier = (uint8_t) mult;
+				scroll_converter conv;
+				conv.set((uint8_t) sensitivity, true, true, high_res, &multiplier);
+				scroll_result r = replay_roll(conv);
+				check_error(r.wheel, r.travel_y, sensitivity, multiplier, high_res);
+				check_error(r.ac_pan, r.travel_x, sensitivity, multiplier, high_res);
+			}
+		}
+	}
+}
+
+void test_slow_roll()
+{
+	// One count per sample still scrolls, a detent per sensitivity counts
+	uint8_t			 multiplier = 1;
+	scroll_converter conv;
+	conv.set(10, true, false, false, &multiplier);
+	int64_t wheel = 0;
+	for(int i = 0; i < 95; i++)
+	{
+		motion_sample s = {};
+		s.y				= 1;
+		conv.process(s);
+		CHECK_EQ(s.ac_pan, 0);
+		wheel += s.wheel;
+	}
+	CHECK_EQ(wheel, 9);
+}
+
+void test_resolution_switch()
+{
+	// The remainder of one mode is in other units, it is dropped when the host switches
+	uint8_t			 multiplier = 120;
+	scroll_converter conv;
+	conv.set(100, true, true, false, &multiplier);
+	motion_sample s = {};
+	s.y				= 99;
+	conv.process(s);
+	CHECK_EQ(s.wheel, 0);
+
+	conv.set(100, true, true, true, &multiplier);
+	s	= {};
+	s.y = 1;
+	conv.process(s);
+	CHECK_EQ(s.wheel, 1);
+
+	// Multiplier 1 in high resolution is the low resolution report
+	multiplier = 1;
+	conv.reset();
+	s	= {};
+	s.y = 250;
+	conv.process(s);
+	CHECK_EQ(s.wheel, 2);
+}
+} // namespace
+
+int main()
+{
+	test_roll_trace();
+	test_all_settings();
+	test_slow_roll();
+	test_resolution_switch();
+	return test_result();
+}
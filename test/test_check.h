@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the host tests, a test returns the number of failed checks from main()
+
+inline int g_test_failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		if(!(cond))                                                                                                    \
+		{                                                                                                              \
+			std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);                                       \
+			g_test_failures++;                                                                                         \
+		}                                                                                                              \
+	} while(0)
+
+#define CHECK_EQ(a, b)                                                                                                 \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		long long check_a_ = (long long) (a);                                                                          \
+		long long check_b_ = (long long) (b);                                                                          \
+		if(check_a_ != check_b_)                                                                                       \
+		{                                                                                                              \
+			std::printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, check_a_,        \
+						check_b_);                                                                                     \
+			g_test_failures++;                                                                                         \
+		}                                                                                                              \
+	} while(0)
+
+inline int test_result()
+{
+	if(g_test_failures)
+	{
+		std::printf("%d check(s) failed\n", g_test_failures);
+		return 1;
+	}
+	std::printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Reassemble raw PAW3395 frames printed by the firmware into PGM images.
+
+Build the firmware with CONFIG_TRACKBALL_FRAME_GRAB, then hold the configuration
+button to capture a frame. The frames are read from a serial port or from a saved
+console log:
+
+    tools/frame_grab.py --port /dev/ttyACM0 --out frames
+    tools/frame_grab.py --log monitor.log --out frames --scale 8
+"""
+
+import argparse
+import os
+import re
+import sys
+
+BEGIN_RE = re.compile(r"FRAME_BEGIN (\d+) (\d+) (\d+)")
+DATA_RE = re.compile(r"FRAME_DATA (\d+) ([0-9A-Fa-f]+)")
+END_RE = re.compile(r"FRAME_END (\d+)")
+
+
+def write_pgm(path, width, height, pixels, scale):
+    with open(path, "wb") as f:
+        f.write(b"P5\n%d %d\n255\n" % (width * scale, height * scale))
+        for y in range(height):
+            row = bytearray()
+            for x in range(width):
+                row += bytes([pixels[y * width + x]]) * scale
+            f.write(bytes(row) * scale)
+
+
+def read_lines(args):
+    if args.log:
+        with open(args.log, "r", errors="replace") as f:
+            yield from f
+        return
+
+    import serial  # pyserial
+
+    with serial.Serial(args.port, args.baud, timeout=1) as port:
+        while True:
+            line = port.readline()
+            if line:
+                yield line.decode(errors="replace")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the trackball console")
+    source.add_argument("--log", help="console log file to parse")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--out", default=".", help="directory for the PGM files")
+    parser.add_argument("--scale", type=int, default=1, help="integer upscale factor")
+    args = parser.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    frame = None
+    for line in read_lines(args):
+        m = BEGIN_RE.search(line)
+        if m:
+            num, width, height = (int(v) for v in m.groups())
+            frame = {"num": num, "width": width, "height": height, "pixels": bytearray(width * height), "bytes": 0}
+            continue
+
+        if frame is None:
+            continue
+
+        m = DATA_RE.search(line)
+        if m:
+            offset = int(m.group(1))
+            data = bytes.fromhex(m.group(2))
+            frame["pixels"][offset : offset + len(data)] = data
+            frame["bytes"] += len(data)
+            continue
+
+        m = END_RE.search(line)
+        if m and int(m.group(1)) == frame["num"]:
+            if frame["bytes"] != len(frame["pixels"]):
+                print("frame %d is incomplete, skipped" % frame["num"], file=sys.stderr)
+            else:
+                path = os.path.join(args.out, "frame_%04d.pgm" % frame["num"])
+                write_pgm(path, frame["width"], frame["height"], frame["pixels"], args.scale)
+                print(path)
+            frame = None
+
+
+if __name__ == "__main__":
+    main()